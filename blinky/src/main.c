@@ -7,6 +7,13 @@
 #include <zephyr/zephyr.h>
 #include <zephyr/drivers/gpio.h>
 
+#if defined(CONFIG_LED_ENGINE)
+#include "led_engine.h"
+
+#define STRIP_NODE DT_ALIAS(led_strip)
+#define STRIP_PIXELS DT_PROP(STRIP_NODE, chain_length)
+#endif
+
 /* 1000 msec = 1 sec */
 #define SLEEP_TIME_MS   1000
 
@@ -32,11 +39,25 @@ void main(void)
 		return;
 	}
 
-	while (1) {
+#if defined(CONFIG_LED_ENGINE)
+	ret = led_engine_start(DEVICE_DT_GET(STRIP_NODE), STRIP_PIXELS);
+	if (ret < 0) {
+		printk("LED strip failed to start (err %d)\n", ret);
+	}
+#endif
+
+	for (uint32_t ticks = 1; ; ticks++) {
 		ret = gpio_pin_toggle_dt(&led);
 		if (ret < 0) {
 			return;
 		}
 		k_msleep(SLEEP_TIME_MS);
+
+#if defined(CONFIG_LED_ENGINE)
+		if (ticks % CONFIG_BLINKY_EFFECT_PERIOD_S == 0) {
+			led_engine_set_effect(ticks /
+					      CONFIG_BLINKY_EFFECT_PERIOD_S);
+		}
+#endif
 	}
 }
@@ -0,0 +1,153 @@
+/** @file
+ *  @brief Interrupt-driven, debounced button input
+ *
+ *  Every edge interrupt restarts a debounce timer; the pin is only read
+ *  once it has been quiet for CONFIG_INPUT_DEBOUNCE_MS. Stable edges
+ *  drive the long press and double click timers. Nothing runs between
+ *  edges, so the CPU can sleep.
+ */
+
+/*
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <errno.h>
+#include <zephyr/zephyr.h>
+#include <zephyr/device.h>
+#include <zephyr/drivers/gpio.h>
+#include <zephyr/sys/printk.h>
+
+#include "input.h"
+
+static const struct gpio_dt_spec *input_button;
+static struct gpio_callback input_cb_data;
+
+K_MSGQ_DEFINE(input_msgq, sizeof(enum input_event), 8, 4);
+
+static atomic_t wakeups;
+static bool stable_pressed;
+static bool long_fired;
+static bool click_pending;
+
+static void post(enum input_event evt)
+{
+	/* A full queue means nobody is reading; dropping is fine */
+	(void)k_msgq_put(&input_msgq, &evt, K_NO_WAIT);
+}
+
+static void long_press_expired(struct k_timer *timer)
+{
+	atomic_inc(&wakeups);
+	long_fired = true;
+	click_pending = false;
+	post(INPUT_LONG_PRESS);
+}
+
+static void double_click_expired(struct k_timer *timer)
+{
+	atomic_inc(&wakeups);
+	if (click_pending) {
+		click_pending = false;
+		post(INPUT_CLICK);
+	}
+}
+
+static K_TIMER_DEFINE(long_press_timer, long_press_expired, NULL);
+static K_TIMER_DEFINE(double_click_timer, double_click_expired, NULL);
+
+static void debounce_expired(struct k_timer *timer)
+{
+	int val;
+
+	atomic_inc(&wakeups);
+
+	val = gpio_pin_get_dt(input_button);
+	if (val < 0 || (val > 0) == stable_pressed) {
+		/* Bounced back to where it was */
+		return;
+	}
+
+	stable_pressed = val > 0;
+
+	if (stable_pressed) {
+		long_fired = false;
+		k_timer_start(&long_press_timer,
+			      K_MSEC(CONFIG_INPUT_LONG_PRESS_MS), K_NO_WAIT);
+		post(INPUT_PRESSED);
+		return;
+	}
+
+	k_timer_stop(&long_press_timer);
+	post(INPUT_RELEASED);
+
+	if (long_fired) {
+		return;
+	}
+
+	if (click_pending) {
+		k_timer_stop(&double_click_timer);
+		click_pending = false;
+		post(INPUT_DOUBLE_CLICK);
+	} else {
+		click_pending = true;
+		k_timer_start(&double_click_timer,
+			      K_MSEC(CONFIG_INPUT_DOUBLE_CLICK_MS), K_NO_WAIT);
+	}
+}
+
+static K_TIMER_DEFINE(debounce_timer, debounce_expired, NULL);
+
+static void input_edge(const struct device *dev, struct gpio_callback *cb,
+		       uint32_t pins)
+{
+	atomic_inc(&wakeups);
+	k_timer_start(&debounce_timer, K_MSEC(CONFIG_INPUT_DEBOUNCE_MS),
+		      K_NO_WAIT);
+}
+
+int input_init(const struct gpio_dt_spec *button)
+{
+	int ret;
+
+	if (!device_is_ready(button->port)) {
+		printk("Error: button device %s is not ready\n",
+		       button->port->name);
+		return -ENODEV;
+	}
+
+	ret = gpio_pin_configure_dt(button, GPIO_INPUT);
+	if (ret != 0) {
+		printk("Error %d: failed to configure %s pin %d\n",
+		       ret, button->port->name, button->pin);
+		return ret;
+	}
+
+	input_button = button;
+
+	ret = gpio_pin_interrupt_configure_dt(button, GPIO_INT_EDGE_BOTH);
+	if (ret != 0) {
+		printk("Error %d: failed to configure interrupt on %s pin %d\n",
+		       ret, button->port->name, button->pin);
+		return ret;
+	}
+
+	gpio_init_callback(&input_cb_data, input_edge, BIT(button->pin));
+	gpio_add_callback(button->port, &input_cb_data);
+	printk("Set up button at %s pin %d\n", button->port->name, button->pin);
+
+	return 0;
+}
+
+enum input_event input_wait(void)
+{
+	enum input_event evt;
+
+	k_msgq_get(&input_msgq, &evt, K_FOREVER);
+
+	return evt;
+}
+
+uint32_t input_wakeups(void)
+{
+	return atomic_get(&wakeups);
+}
@@ -0,0 +1,33 @@
+/** @file
+ *  @brief Interrupt-driven, debounced button input
+ */
+
+/*
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <zephyr/drivers/gpio.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+enum input_event {
+	INPUT_PRESSED,
+	INPUT_RELEASED,
+	/* Released before the long press time, no second click followed */
+	INPUT_CLICK,
+	INPUT_DOUBLE_CLICK,
+	/* Still held after the long press time */
+	INPUT_LONG_PRESS,
+};
+
+int input_init(const struct gpio_dt_spec *button);
+/* Blocks until the next event; the CPU sleeps in between */
+enum input_event input_wait(void);
+/* GPIO interrupts plus debounce/gesture timer expiries so far */
+uint32_t input_wakeups(void);
+
+#ifdef __cplusplus
+}
+#endif
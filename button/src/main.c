@@ -10,9 +10,17 @@
 #include <zephyr/drivers/gpio.h>
 #include <zephyr/sys/util.h>
 #include <zephyr/sys/printk.h>
+#include <zephyr/logging/log.h>
 #include <inttypes.h>
 
-#define SLEEP_TIME_MS	1
+#include "input.h"
+
+LOG_MODULE_REGISTER(button, CONFIG_BUTTON_LOG_LEVEL);
+
+/* Period of the pin polling loop this sample used before it went
+ * interrupt driven; only kept to report the wakeups saved.
+ */
+#define POLL_PERIOD_MS	1
 
 /*
  * Get button configuration from the devicetree sw0 alias. This is mandatory.
@@ -23,7 +31,6 @@
 #endif
 static const struct gpio_dt_spec button = GPIO_DT_SPEC_GET_OR(SW0_NODE, gpios,
 							      {0});
-static struct gpio_callback button_cb_data;
 
 /*
  * The led0 devicetree alias is optional. If present, we'll use it
@@ -34,13 +41,6 @@ static struct gpio_dt_spec led = GPIO_DT_SPEC_GET_OR(DT_ALIAS(led0), gpios,
 static struct gpio_dt_spec toggle_led = GPIO_DT_SPEC_GET_OR(DT_ALIAS(led1), gpios,
 						     {0});
 
-void button_pressed(const struct device *dev, struct gpio_callback *cb,
-		    uint32_t pins)
-{
-	printk("Button pressed at %" PRIu32 "\n", k_cycle_get_32());
-	gpio_pin_toggle_dt(&toggle_led);
-}
-
 void configure_led(struct gpio_dt_spec l) {
 	int ret;
 	if (l.port && !device_is_ready(l.port)) {
@@ -60,23 +60,48 @@ void configure_led(struct gpio_dt_spec l) {
 	}
 }
 
+static const char *const event_names[] = {
+	[INPUT_PRESSED] = "pressed",
+	[INPUT_RELEASED] = "released",
+	[INPUT_CLICK] = "click",
+	[INPUT_DOUBLE_CLICK] = "double click",
+	[INPUT_LONG_PRESS] = "long press",
+};
+
 void main(void)
 {
-	int ret;
-
 	configure_led(led);
 	configure_led(toggle_led);
 
+	if (input_init(&button)) {
+		return;
+	}
+
 	printk("Press the button\n");
-	if (led.port) {
-		while (1) {
-			/* If we have an LED, match its state to the button's. */
-			int val = gpio_pin_get_dt(&button);
+	while (1) {
+		enum input_event evt = input_wait();
 
-			if (val >= 0) {
-				gpio_pin_set_dt(&led, val);
+		switch (evt) {
+		case INPUT_PRESSED:
+		case INPUT_RELEASED:
+			/* If we have an LED, match its state to the button's. */
+			if (led.port) {
+				gpio_pin_set_dt(&led, evt == INPUT_PRESSED);
+			}
+			break;
+		case INPUT_CLICK:
+		case INPUT_DOUBLE_CLICK:
+			if (toggle_led.port) {
+				gpio_pin_toggle_dt(&toggle_led);
 			}
-			k_msleep(SLEEP_TIME_MS);
+			break;
+		default:
+			break;
 		}
+
+		LOG_INF("Button %s at %" PRIu32 ", %u wakeups so far "
+			"(polling every %d ms: %u)",
+			event_names[evt], k_cycle_get_32(), input_wakeups(),
+			POLL_PERIOD_MS, k_uptime_get_32() / POLL_PERIOD_MS);
 	}
 }
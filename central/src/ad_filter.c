@@ -0,0 +1,64 @@
+/** @file
+ *  @brief Advertising data filter
+ *
+ *  Single pass over the AD structures of one report, in place and in any
+ *  order. Every length byte is checked against the remaining buffer so a
+ *  truncated or malformed report is rejected instead of overrun.
+ */
+
+/*
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <zephyr/types.h>
+#include <stddef.h>
+#include <string.h>
+#include <zephyr/bluetooth/bluetooth.h>
+#include <zephyr/bluetooth/uuid.h>
+
+#include "ad_filter.h"
+
+/* Returns true as soon as target is found, false on the first complete
+ * 128-bit UUID list that lacks it or on malformed data.
+ */
+bool ad_has_target(const struct net_buf_simple *ad, const uint8_t *target)
+{
+	const uint8_t *ptr = ad->data;
+	const uint8_t *end = ad->data + ad->len;
+
+	while (end - ptr >= 2) {
+		uint8_t len = ptr[0];
+
+		/* Zero length marks early termination of significant data */
+		if (len == 0U) {
+			return false;
+		}
+
+		if (len > end - ptr - 1) {
+			return false;
+		}
+
+		uint8_t ad_type = ptr[1];
+		const uint8_t *data = &ptr[2];
+		uint8_t data_len = len - 1;
+
+		if (ad_type == BT_DATA_UUID128_ALL ||
+		    ad_type == BT_DATA_UUID128_SOME) {
+			for (; data_len >= BT_UUID_SIZE_128;
+			     data += BT_UUID_SIZE_128, data_len -= BT_UUID_SIZE_128) {
+				if (!memcmp(data, target, BT_UUID_SIZE_128)) {
+					return true;
+				}
+			}
+
+			/* A complete list without our service rules the device out */
+			if (ad_type == BT_DATA_UUID128_ALL) {
+				return false;
+			}
+		}
+
+		ptr += len + 1;
+	}
+
+	return false;
+}
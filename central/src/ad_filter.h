@@ -0,0 +1,23 @@
+/** @file
+ *  @brief Advertising data filter
+ */
+
+/*
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <zephyr/types.h>
+#include <zephyr/net/buf.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* True if the report lists the 128-bit service UUID target, given in
+ * advertising (little endian) byte order.
+ */
+bool ad_has_target(const struct net_buf_simple *ad, const uint8_t *target);
+
+#ifdef __cplusplus
+}
+#endif
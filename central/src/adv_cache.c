@@ -0,0 +1,123 @@
+/** @file
+ *  @brief Cache of rejected advertisers
+ *
+ *  Fixed-size open-addressed hash table keyed by advertiser address.
+ *  Only the scan callback touches it, so no locking is needed.
+ */
+
+/*
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <zephyr/types.h>
+#include <stddef.h>
+#include <string.h>
+#include <zephyr/zephyr.h>
+
+#include <zephyr/bluetooth/addr.h>
+
+#include "adv_cache.h"
+
+/* Slots probed from the home slot before giving up */
+#define ADV_CACHE_PROBES 4
+
+struct adv_cache_entry {
+	bt_addr_le_t addr;
+	uint32_t expires;
+	bool used;
+};
+
+static struct adv_cache_entry cache[CONFIG_CENTRAL_ADV_CACHE_SIZE];
+static uint32_t cache_hits;
+static uint32_t cache_misses;
+
+static uint32_t addr_hash(const bt_addr_le_t *addr)
+{
+	/* FNV-1a over the address type and the six address bytes */
+	uint32_t hash = 2166136261U;
+
+	hash = (hash ^ addr->type) * 16777619U;
+	for (size_t i = 0; i < sizeof(addr->a.val); i++) {
+		hash = (hash ^ addr->a.val[i]) * 16777619U;
+	}
+
+	return hash;
+}
+
+static bool entry_expired(const struct adv_cache_entry *entry, uint32_t now)
+{
+	return (int32_t)(entry->expires - now) <= 0;
+}
+
+static struct adv_cache_entry *entry_find(const bt_addr_le_t *addr)
+{
+	uint32_t slot = addr_hash(addr) % ARRAY_SIZE(cache);
+
+	for (int i = 0; i < ADV_CACHE_PROBES; i++) {
+		struct adv_cache_entry *entry = &cache[slot];
+
+		if (entry->used && !bt_addr_le_cmp(&entry->addr, addr)) {
+			return entry;
+		}
+
+		slot = (slot + 1) % ARRAY_SIZE(cache);
+	}
+
+	return NULL;
+}
+
+bool adv_cache_lookup(const bt_addr_le_t *addr)
+{
+	struct adv_cache_entry *entry = entry_find(addr);
+
+	if (entry && !entry_expired(entry, k_uptime_get_32())) {
+		cache_hits++;
+		return true;
+	}
+
+	cache_misses++;
+	return false;
+}
+
+void adv_cache_add(const bt_addr_le_t *addr, enum adv_cache_reason reason)
+{
+	uint32_t now = k_uptime_get_32();
+	uint32_t slot = addr_hash(addr) % ARRAY_SIZE(cache);
+	struct adv_cache_entry *entry = entry_find(addr);
+
+	/* Otherwise take a free or expired slot, or evict the oldest */
+	for (int i = 0; !entry && i < ADV_CACHE_PROBES; i++) {
+		struct adv_cache_entry *candidate = &cache[slot];
+
+		if (!candidate->used || entry_expired(candidate, now)) {
+			entry = candidate;
+		}
+
+		slot = (slot + 1) % ARRAY_SIZE(cache);
+	}
+
+	if (!entry) {
+		slot = addr_hash(addr) % ARRAY_SIZE(cache);
+		entry = &cache[slot];
+		for (int i = 1; i < ADV_CACHE_PROBES; i++) {
+			struct adv_cache_entry *candidate =
+				&cache[(slot + i) % ARRAY_SIZE(cache)];
+
+			if ((int32_t)(candidate->expires - entry->expires) < 0) {
+				entry = candidate;
+			}
+		}
+	}
+
+	bt_addr_le_copy(&entry->addr, addr);
+	entry->expires = now + (reason == ADV_CACHE_RSSI ?
+				CONFIG_CENTRAL_ADV_CACHE_RSSI_TTL_MS :
+				CONFIG_CENTRAL_ADV_CACHE_REJECT_TTL_MS);
+	entry->used = true;
+}
+
+void adv_cache_stats(uint32_t *hits, uint32_t *misses)
+{
+	*hits = cache_hits;
+	*misses = cache_misses;
+}
@@ -0,0 +1,28 @@
+/** @file
+ *  @brief Cache of rejected advertisers
+ */
+
+/*
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <zephyr/bluetooth/addr.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+enum adv_cache_reason {
+	/* Advertising data does not carry the key service */
+	ADV_CACHE_REJECTED,
+	/* Signal was too weak to connect */
+	ADV_CACHE_RSSI,
+};
+
+bool adv_cache_lookup(const bt_addr_le_t *addr);
+void adv_cache_add(const bt_addr_le_t *addr, enum adv_cache_reason reason);
+void adv_cache_stats(uint32_t *hits, uint32_t *misses);
+
+#ifdef __cplusplus
+}
+#endif
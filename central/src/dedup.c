@@ -0,0 +1,67 @@
+/** @file
+ *  @brief Duplicate suppression for presses heard over several paths
+ *
+ *  A press can reach the hub directly and through one or more relays.
+ *  The last CONFIG_CENTRAL_DEDUP_SIZE (origin, seq) pairs are kept in a
+ *  ring; presses arrive close together on every path, so a short window
+ *  is enough and a linear scan stays cheap.
+ */
+
+/*
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <zephyr/types.h>
+#include <zephyr/zephyr.h>
+
+#include "dedup.h"
+
+struct dedup_entry {
+	uint32_t origin;
+	uint16_t seq;
+	bool used;
+};
+
+static struct dedup_entry entries[CONFIG_CENTRAL_DEDUP_SIZE];
+static size_t next;
+static uint32_t checked;
+static uint32_t duplicates;
+static K_MUTEX_DEFINE(dedup_lock);
+
+bool dedup_seen(uint32_t origin, uint16_t seq)
+{
+	bool seen = false;
+
+	k_mutex_lock(&dedup_lock, K_FOREVER);
+
+	checked++;
+
+	for (size_t i = 0; i < ARRAY_SIZE(entries); i++) {
+		if (entries[i].used && entries[i].origin == origin &&
+		    entries[i].seq == seq) {
+			seen = true;
+			break;
+		}
+	}
+
+	if (seen) {
+		duplicates++;
+	} else {
+		entries[next] = (struct dedup_entry) {
+			.origin = origin,
+			.seq = seq,
+			.used = true,
+		};
+		next = (next + 1) % ARRAY_SIZE(entries);
+	}
+
+	k_mutex_unlock(&dedup_lock);
+
+	return seen;
+}
+
+void dedup_stats(uint32_t *checked_out, uint32_t *duplicates_out)
+{
+	*checked_out = checked;
+	*duplicates_out = duplicates;
+}
@@ -0,0 +1,22 @@
+/** @file
+ *  @brief Duplicate suppression for presses heard over several paths
+ */
+
+/*
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <zephyr/types.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* True if (origin, seq) was seen recently, otherwise remembers it */
+bool dedup_seen(uint32_t origin, uint16_t seq);
+
+void dedup_stats(uint32_t *checked, uint32_t *duplicates);
+
+#ifdef __cplusplus
+}
+#endif
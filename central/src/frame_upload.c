@@ -0,0 +1,288 @@
+/** @file
+ *  @brief LED frame upload to the connected peripherals
+ *
+ *  A low priority thread renders the animation and sends each peripheral
+ *  the pixels that changed since the frame it last received, over an
+ *  L2CAP connection-oriented channel. The peripheral hands out credits as
+ *  it consumes SDUs. Without credits the stack queues SDUs on the channel,
+ *  holding on to their buffers, so a slow peripheral throttles the thread
+ *  through the small SDU pool rather than through the send call.
+ *
+ *  Connections are handed to the thread through a queue, since only it
+ *  may reset a channel's state.
+ */
+
+/*
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <zephyr/types.h>
+#include <stddef.h>
+#include <string.h>
+#include <errno.h>
+#include <zephyr/zephyr.h>
+#include <zephyr/sys/printk.h>
+#include <zephyr/sys/byteorder.h>
+#include <zephyr/net/buf.h>
+
+#include <zephyr/bluetooth/bluetooth.h>
+#include <zephyr/bluetooth/conn.h>
+#include <zephyr/bluetooth/l2cap.h>
+
+#include "frame_upload.h"
+#include "led_engine.h"
+#include "led_frame.h"
+
+#define PIXELS CONFIG_LED_UPLOAD_PIXELS
+#define STATS_INTERVAL_MS 5000
+#define EFFECT_PERIOD_MS 10000
+
+NET_BUF_POOL_FIXED_DEFINE(upload_pool, CONFIG_LED_UPLOAD_TX_BUFS,
+			  BT_L2CAP_SDU_BUF_SIZE(CONFIG_LED_UPLOAD_MTU),
+			  CONFIG_BT_CONN_TX_USER_DATA_SIZE, NULL);
+
+struct upload_chan {
+	struct bt_l2cap_le_chan le;
+	bool ready;
+	bool reset;
+	/* What the peripheral holds, deltas are taken against it */
+	struct led_rgb shadow[PIXELS];
+
+	int64_t window_start;
+	uint32_t frames;
+	uint32_t bytes;
+	/* Every SDU buffer was still queued when a frame needed one */
+	uint32_t stalls;
+	uint32_t failed;
+};
+
+static struct upload_chan chans[CONFIG_BT_MAX_CONN];
+/* Referenced connections waiting for frame_upload_connect() to be served */
+K_MSGQ_DEFINE(connect_q, sizeof(struct bt_conn *), CONFIG_BT_MAX_CONN, 4);
+static struct led_rgb frame[PIXELS];
+static uint16_t frame_num;
+
+static void upload_stats_print(struct upload_chan *uc, int64_t now)
+{
+	uint32_t elapsed = MAX(now - uc->window_start, 1);
+	/* Bytes per millisecond is kB/s; keep two decimals */
+	uint32_t rate = (uint64_t)uc->bytes * 100U / elapsed;
+	uint32_t raw = uc->frames * PIXELS * LED_FRAME_PIXEL_SIZE;
+
+	printk("[UPLOAD] conn %u: %u.%02u kB/s, %u frames, %u%% of raw, "
+	       "%u buffer stalls, %u failed\n",
+	       (unsigned int)(uc - chans), rate / 100U, rate % 100U, uc->frames,
+	       raw ? (uint32_t)((uint64_t)uc->bytes * 100U / raw) : 0,
+	       uc->stalls, uc->failed);
+
+	uc->window_start = now;
+	uc->frames = 0;
+	uc->bytes = 0;
+	uc->stalls = 0;
+	uc->failed = 0;
+}
+
+static int upload_send(struct upload_chan *uc, struct net_buf *buf)
+{
+	size_t len = buf->len;
+	/* Queued behind earlier SDUs when the peripheral is out of credits */
+	int err = bt_l2cap_chan_send(&uc->le.chan, buf);
+
+	if (err < 0) {
+		net_buf_unref(buf);
+		return err;
+	}
+
+	uc->bytes += len;
+
+	return 0;
+}
+
+static void upload_frame(struct upload_chan *uc)
+{
+	size_t mtu = MIN(uc->le.tx.mtu, CONFIG_LED_UPLOAD_MTU);
+	uint8_t flags = 0;
+	size_t cursor = 0;
+
+	if (uc->reset) {
+		memset(uc->shadow, 0, sizeof(uc->shadow));
+		uc->reset = false;
+		flags |= LED_FRAME_RESET;
+	}
+
+	do {
+		struct net_buf *buf;
+		uint8_t *hdr;
+		size_t len;
+
+		buf = net_buf_alloc(&upload_pool, K_NO_WAIT);
+		if (!buf) {
+			/* Wait for the channel to send what it has queued */
+			uc->stalls++;
+			buf = net_buf_alloc(&upload_pool, K_MSEC(100));
+		}
+		if (!buf) {
+			/* Nothing was encoded, so the shadow still matches */
+			uc->failed++;
+			return;
+		}
+
+		net_buf_reserve(buf, BT_L2CAP_SDU_CHAN_SEND_RESERVE);
+		hdr = net_buf_add(buf, LED_FRAME_HEADER_SIZE);
+		len = led_frame_encode(uc->shadow, frame, PIXELS, &cursor,
+				       net_buf_tail(buf),
+				       MIN(net_buf_tailroom(buf),
+					   mtu - LED_FRAME_HEADER_SIZE));
+		net_buf_add(buf, len);
+
+		sys_put_le16(frame_num, hdr);
+		hdr[2] = flags | (cursor == PIXELS ? LED_FRAME_END : 0);
+		flags = 0;
+
+		if (upload_send(uc, buf)) {
+			/* The shadow moved ahead of the peripheral */
+			uc->failed++;
+			uc->reset = true;
+			return;
+		}
+	} while (cursor < PIXELS);
+
+	uc->frames++;
+}
+
+static void upload_open(struct bt_conn *conn);
+
+/* Opens the channels asked for, waiting up to timeout for the first */
+static void connect_requests(k_timeout_t timeout)
+{
+	struct bt_conn *conn;
+
+	while (!k_msgq_get(&connect_q, &conn, timeout)) {
+		upload_open(conn);
+		bt_conn_unref(conn);
+		timeout = K_NO_WAIT;
+	}
+}
+
+static bool chans_ready(void)
+{
+	for (size_t i = 0; i < ARRAY_SIZE(chans); i++) {
+		if (chans[i].ready) {
+			return true;
+		}
+	}
+
+	return false;
+}
+
+static void upload_thread(void *p1, void *p2, void *p3)
+{
+	while (1) {
+		int64_t start = k_uptime_get();
+
+		connect_requests(K_NO_WAIT);
+
+		/* Nothing to render for until a channel comes up */
+		if (!chans_ready()) {
+			connect_requests(K_MSEC(100));
+			continue;
+		}
+
+		led_effect_render((start / EFFECT_PERIOD_MS) % LED_EFFECT_COUNT,
+				  frame, PIXELS, (uint32_t)start);
+		frame_num++;
+
+		for (size_t i = 0; i < ARRAY_SIZE(chans); i++) {
+			struct upload_chan *uc = &chans[i];
+
+			if (!uc->ready) {
+				continue;
+			}
+
+			upload_frame(uc);
+
+			if (k_uptime_get() - uc->window_start >=
+			    STATS_INTERVAL_MS) {
+				upload_stats_print(uc, k_uptime_get());
+			}
+		}
+
+		if (CONFIG_LED_UPLOAD_FRAME_MS) {
+			k_sleep(K_TIMEOUT_ABS_MS(start +
+						 CONFIG_LED_UPLOAD_FRAME_MS));
+		}
+	}
+}
+
+K_THREAD_DEFINE(frame_upload, 1536, upload_thread, NULL, NULL, NULL,
+		K_LOWEST_APPLICATION_THREAD_PRIO, 0, 0);
+
+static void upload_connected(struct bt_l2cap_chan *chan)
+{
+	struct upload_chan *uc = CONTAINER_OF(chan, struct upload_chan, le.chan);
+
+	printk("[UPLOAD] channel up, tx mtu %u mps %u\n", uc->le.tx.mtu,
+	       uc->le.tx.mps);
+
+	uc->window_start = k_uptime_get();
+	uc->reset = true;
+	uc->ready = true;
+}
+
+static void upload_disconnected(struct bt_l2cap_chan *chan)
+{
+	struct upload_chan *uc = CONTAINER_OF(chan, struct upload_chan, le.chan);
+
+	if (uc->ready) {
+		upload_stats_print(uc, k_uptime_get());
+	}
+
+	uc->ready = false;
+}
+
+static int upload_recv(struct bt_l2cap_chan *chan, struct net_buf *buf)
+{
+	/* The channel only carries frames towards the peripheral */
+	return 0;
+}
+
+static const struct bt_l2cap_chan_ops upload_ops = {
+	.connected = upload_connected,
+	.disconnected = upload_disconnected,
+	.recv = upload_recv,
+};
+
+/* Upload thread only: nothing else reads the slot while it is reset */
+static void upload_open(struct bt_conn *conn)
+{
+	struct upload_chan *uc = &chans[bt_conn_index(conn)];
+	int err;
+
+	/* The stack keeps conn set until the channel is released */
+	if (uc->le.chan.conn) {
+		return;
+	}
+
+	memset(uc, 0, sizeof(*uc));
+	uc->le.chan.ops = &upload_ops;
+	uc->le.rx.mtu = CONFIG_LED_UPLOAD_MTU;
+
+	err = bt_l2cap_chan_connect(conn, &uc->le.chan, LED_FRAME_PSM);
+	if (err) {
+		printk("[UPLOAD] channel connect failed (err %d)\n", err);
+	}
+}
+
+int frame_upload_connect(struct bt_conn *conn)
+{
+	struct bt_conn *ref = bt_conn_ref(conn);
+	int err;
+
+	err = k_msgq_put(&connect_q, &ref, K_NO_WAIT);
+	if (err) {
+		bt_conn_unref(ref);
+		return err;
+	}
+
+	return 0;
+}
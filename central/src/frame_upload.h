@@ -0,0 +1,23 @@
+/** @file
+ *  @brief LED frame upload to the connected peripherals
+ */
+
+/*
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <zephyr/bluetooth/conn.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Asks the upload thread to open the frame channel to a peripheral;
+ * frames flow once it is up. Returns -ENOMSG when too many requests are
+ * already pending.
+ */
+int frame_upload_connect(struct bt_conn *conn);
+
+#ifdef __cplusplus
+}
+#endif
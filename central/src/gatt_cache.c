@@ -0,0 +1,196 @@
+/** @file
+ *  @brief Persistent cache of discovered PRESS handles
+ *
+ *  One entry per bonded peer, kept in RAM and mirrored to settings under
+ *  "gattc/<type><address>" so it survives a reboot.
+ */
+
+/*
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <zephyr/types.h>
+#include <stddef.h>
+#include <string.h>
+#include <errno.h>
+#include <zephyr/zephyr.h>
+#include <zephyr/sys/printk.h>
+#include <zephyr/sys/util.h>
+#include <zephyr/settings/settings.h>
+
+#include <zephyr/bluetooth/addr.h>
+
+#include "gatt_cache.h"
+
+#define GATT_CACHE_SUBTREE "gattc"
+/* Address type byte followed by the six address bytes, hex encoded */
+#define GATT_CACHE_NAME_LEN ((1 + sizeof(bt_addr_t)) * 2)
+
+/* What is written to settings; the address lives in the key */
+struct gatt_cache_record {
+	uint8_t db_hash[GATT_CACHE_HASH_LEN];
+	uint16_t value_handle;
+	uint16_t ccc_handle;
+} __packed;
+
+static struct gatt_cache_entry cache[CONFIG_BT_MAX_PAIRED];
+static K_MUTEX_DEFINE(cache_lock);
+
+static void encode_name(const bt_addr_le_t *addr, char *name)
+{
+	uint8_t raw[1 + sizeof(bt_addr_t)];
+
+	raw[0] = addr->type;
+	memcpy(&raw[1], addr->a.val, sizeof(addr->a.val));
+	bin2hex(raw, sizeof(raw), name, GATT_CACHE_NAME_LEN + 1);
+}
+
+static int decode_name(const char *name, bt_addr_le_t *addr)
+{
+	uint8_t raw[1 + sizeof(bt_addr_t)];
+
+	if (settings_name_next(name, NULL) != GATT_CACHE_NAME_LEN ||
+	    hex2bin(name, GATT_CACHE_NAME_LEN, raw, sizeof(raw)) != sizeof(raw)) {
+		return -EINVAL;
+	}
+
+	addr->type = raw[0];
+	memcpy(addr->a.val, &raw[1], sizeof(addr->a.val));
+
+	return 0;
+}
+
+static struct gatt_cache_entry *entry_lookup(const bt_addr_le_t *addr)
+{
+	for (size_t i = 0; i < ARRAY_SIZE(cache); i++) {
+		if (cache[i].ccc_handle && !bt_addr_le_cmp(&cache[i].addr, addr)) {
+			return &cache[i];
+		}
+	}
+
+	return NULL;
+}
+
+static struct gatt_cache_entry *entry_alloc(const bt_addr_le_t *addr)
+{
+	struct gatt_cache_entry *entry = entry_lookup(addr);
+
+	for (size_t i = 0; !entry && i < ARRAY_SIZE(cache); i++) {
+		if (!cache[i].ccc_handle) {
+			entry = &cache[i];
+		}
+	}
+
+	return entry;
+}
+
+bool gatt_cache_find(const bt_addr_le_t *addr, struct gatt_cache_entry *entry)
+{
+	struct gatt_cache_entry *found;
+
+	k_mutex_lock(&cache_lock, K_FOREVER);
+	found = entry_lookup(addr);
+	if (found) {
+		*entry = *found;
+	}
+	k_mutex_unlock(&cache_lock);
+
+	return found != NULL;
+}
+
+int gatt_cache_store(const struct gatt_cache_entry *entry)
+{
+	char key[sizeof(GATT_CACHE_SUBTREE "/") + GATT_CACHE_NAME_LEN];
+	struct gatt_cache_record record;
+	struct gatt_cache_entry *slot;
+
+	k_mutex_lock(&cache_lock, K_FOREVER);
+	slot = entry_alloc(&entry->addr);
+	if (!slot) {
+		k_mutex_unlock(&cache_lock);
+		return -ENOMEM;
+	}
+
+	if (!bt_addr_le_cmp(&slot->addr, &entry->addr) &&
+	    !memcmp(slot->db_hash, entry->db_hash, sizeof(slot->db_hash)) &&
+	    slot->value_handle == entry->value_handle &&
+	    slot->ccc_handle == entry->ccc_handle) {
+		/* Unchanged, spare the flash */
+		k_mutex_unlock(&cache_lock);
+		return 0;
+	}
+
+	*slot = *entry;
+	k_mutex_unlock(&cache_lock);
+
+	memcpy(record.db_hash, entry->db_hash, sizeof(record.db_hash));
+	record.value_handle = entry->value_handle;
+	record.ccc_handle = entry->ccc_handle;
+
+	strcpy(key, GATT_CACHE_SUBTREE "/");
+	encode_name(&entry->addr, &key[sizeof(GATT_CACHE_SUBTREE)]);
+
+	return settings_save_one(key, &record, sizeof(record));
+}
+
+void gatt_cache_delete(const bt_addr_le_t *addr)
+{
+	char key[sizeof(GATT_CACHE_SUBTREE "/") + GATT_CACHE_NAME_LEN];
+	struct gatt_cache_entry *entry;
+
+	k_mutex_lock(&cache_lock, K_FOREVER);
+	entry = entry_lookup(addr);
+	if (entry) {
+		(void)memset(entry, 0, sizeof(*entry));
+	}
+	k_mutex_unlock(&cache_lock);
+
+	if (!entry) {
+		return;
+	}
+
+	strcpy(key, GATT_CACHE_SUBTREE "/");
+	encode_name(addr, &key[sizeof(GATT_CACHE_SUBTREE)]);
+	settings_delete(key);
+}
+
+static int gatt_cache_set(const char *name, size_t len,
+			  settings_read_cb read_cb, void *cb_arg)
+{
+	struct gatt_cache_record record;
+	struct gatt_cache_entry *entry;
+	bt_addr_le_t addr;
+	ssize_t ret;
+
+	if (!name || decode_name(name, &addr)) {
+		return -ENOENT;
+	}
+
+	if (len != sizeof(record)) {
+		return -EINVAL;
+	}
+
+	ret = read_cb(cb_arg, &record, sizeof(record));
+	if (ret < 0) {
+		return ret;
+	}
+
+	k_mutex_lock(&cache_lock, K_FOREVER);
+	entry = entry_alloc(&addr);
+	if (entry) {
+		bt_addr_le_copy(&entry->addr, &addr);
+		memcpy(entry->db_hash, record.db_hash, sizeof(entry->db_hash));
+		entry->value_handle = record.value_handle;
+		entry->ccc_handle = record.ccc_handle;
+	}
+	k_mutex_unlock(&cache_lock);
+
+	if (!entry) {
+		printk("GATT cache full, dropping stored handles\n");
+	}
+
+	return 0;
+}
+
+SETTINGS_STATIC_HANDLER_DEFINE(gatt_cache, GATT_CACHE_SUBTREE, NULL,
+			       gatt_cache_set, NULL, NULL);
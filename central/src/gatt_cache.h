@@ -0,0 +1,32 @@
+/** @file
+ *  @brief Persistent cache of discovered PRESS handles
+ */
+
+/*
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <zephyr/bluetooth/addr.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define GATT_CACHE_HASH_LEN 16
+
+struct gatt_cache_entry {
+	bt_addr_le_t addr;
+	/* Database Hash of the peer when the handles were discovered */
+	uint8_t db_hash[GATT_CACHE_HASH_LEN];
+	uint16_t value_handle;
+	uint16_t ccc_handle;
+};
+
+/* Returns false when nothing is cached for addr */
+bool gatt_cache_find(const bt_addr_le_t *addr, struct gatt_cache_entry *entry);
+int gatt_cache_store(const struct gatt_cache_entry *entry);
+void gatt_cache_delete(const bt_addr_le_t *addr);
+
+#ifdef __cplusplus
+}
+#endif
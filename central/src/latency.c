@@ -0,0 +1,168 @@
+/** @file
+ *  @brief Button-to-notification latency histogram
+ *
+ *  A sample runs from the edge on the peripheral to the central parsing
+ *  the notification that carries it; the LED toggle that follows is
+ *  timed separately by CONFIG_CENTRAL_HOT_PATH_STATS. Fixed buckets, so
+ *  recording is constant time and the percentiles are reported as the
+ *  upper edge of the bucket they fall in.
+ */
+
+/*
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <zephyr/types.h>
+#include <stddef.h>
+#include <string.h>
+#include <zephyr/zephyr.h>
+#include <zephyr/sys/printk.h>
+#include <zephyr/shell/shell.h>
+
+#include "latency.h"
+
+/* Upper bucket edges in microseconds; the last bucket is open ended */
+static const uint32_t edges_us[] = {
+	1000, 2000, 3000, 4000, 5000, 6000, 8000, 10000, 12500, 15000,
+	20000, 25000, 30000, 40000, 50000, 75000, 100000, 150000, 250000,
+	500000, 1000000,
+};
+
+static struct {
+	uint32_t buckets[ARRAY_SIZE(edges_us) + 1];
+	uint32_t count;
+	uint32_t max_us;
+} hist;
+
+static struct k_spinlock hist_lock;
+
+void latency_record(uint32_t us)
+{
+	size_t i = 0;
+
+	while (i < ARRAY_SIZE(edges_us) && us > edges_us[i]) {
+		i++;
+	}
+
+	k_spinlock_key_t key = k_spin_lock(&hist_lock);
+
+	hist.buckets[i]++;
+	hist.count++;
+	hist.max_us = MAX(hist.max_us, us);
+	k_spin_unlock(&hist_lock, key);
+}
+
+void latency_reset(void)
+{
+	k_spinlock_key_t key = k_spin_lock(&hist_lock);
+
+	(void)memset(&hist, 0, sizeof(hist));
+	k_spin_unlock(&hist_lock, key);
+}
+
+/* Upper edge of the bucket holding the given per-mille rank */
+static uint32_t percentile(const uint32_t *buckets, uint32_t count,
+			   uint32_t max_us, uint32_t permille)
+{
+	uint32_t rank = DIV_ROUND_UP((uint64_t)count * permille, 1000U);
+	uint32_t seen = 0;
+
+	for (size_t i = 0; i < ARRAY_SIZE(edges_us); i++) {
+		seen += buckets[i];
+		if (seen >= rank) {
+			return MIN(edges_us[i], max_us);
+		}
+	}
+
+	return max_us;
+}
+
+static void snapshot(uint32_t *buckets, uint32_t *count, uint32_t *max_us)
+{
+	k_spinlock_key_t key = k_spin_lock(&hist_lock);
+
+	memcpy(buckets, hist.buckets, sizeof(hist.buckets));
+	*count = hist.count;
+	*max_us = hist.max_us;
+	k_spin_unlock(&hist_lock, key);
+}
+
+void latency_summary(uint32_t *count, uint32_t *p50_us, uint32_t *p99_us,
+		     uint32_t *max_us)
+{
+	uint32_t buckets[ARRAY_SIZE(hist.buckets)];
+
+	snapshot(buckets, count, max_us);
+	*p50_us = *count ? percentile(buckets, *count, *max_us, 500) : 0;
+	*p99_us = *count ? percentile(buckets, *count, *max_us, 990) : 0;
+}
+
+/* One line to the shell that ran the command, or to the console */
+#define print_line(sh, fmt, ...)					\
+	do {								\
+		if (IS_ENABLED(CONFIG_SHELL) && (sh)) {			\
+			shell_print(sh, fmt, __VA_ARGS__);		\
+		} else {						\
+			printk(fmt "\n", __VA_ARGS__);			\
+		}							\
+	} while (0)
+
+void latency_print(const struct shell *sh)
+{
+	uint32_t buckets[ARRAY_SIZE(hist.buckets)];
+	uint32_t count, max_us;
+
+	snapshot(buckets, &count, &max_us);
+
+	if (!count) {
+		print_line(sh, "[LATENCY] %u samples", count);
+		return;
+	}
+
+	print_line(sh, "[LATENCY] %u samples, p50 <= %u us, p99 <= %u us, "
+		   "max %u us", count, percentile(buckets, count, max_us, 500),
+		   percentile(buckets, count, max_us, 990), max_us);
+
+	for (size_t i = 0; i < ARRAY_SIZE(buckets); i++) {
+		if (!buckets[i]) {
+			continue;
+		}
+
+		if (i < ARRAY_SIZE(edges_us)) {
+			print_line(sh, "  <= %7u us: %u", edges_us[i],
+				   buckets[i]);
+		} else {
+			print_line(sh, "   > %7u us: %u", edges_us[i - 1],
+				   buckets[i]);
+		}
+	}
+}
+
+#if defined(CONFIG_SHELL)
+static int cmd_latency_show(const struct shell *sh, size_t argc, char **argv)
+{
+	latency_print(sh);
+
+	return 0;
+}
+
+static int cmd_latency_reset(const struct shell *sh, size_t argc, char **argv)
+{
+	latency_reset();
+	shell_print(sh, "Latency histogram cleared");
+
+	return 0;
+}
+
+SHELL_STATIC_SUBCMD_SET_CREATE(latency_cmds,
+	SHELL_CMD(show, NULL,
+		  "Print the button-to-notification latency histogram",
+		  cmd_latency_show),
+	SHELL_CMD(reset, NULL, "Clear the latency histogram",
+		  cmd_latency_reset),
+	SHELL_SUBCMD_SET_END
+);
+
+SHELL_CMD_REGISTER(latency, &latency_cmds, "Button-to-notification latency",
+		   NULL);
+#endif /* CONFIG_SHELL */
@@ -0,0 +1,28 @@
+/** @file
+ *  @brief Button-to-notification latency histogram
+ */
+
+/*
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <zephyr/types.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+struct shell;
+
+void latency_record(uint32_t us);
+void latency_reset(void);
+/* Prints the histogram to sh, or with printk when sh is NULL */
+void latency_print(const struct shell *sh);
+
+/* Sample count and the p50, p99 and max latency, all 0 without samples */
+void latency_summary(uint32_t *count, uint32_t *p50_us, uint32_t *p99_us,
+		     uint32_t *max_us);
+
+#ifdef __cplusplus
+}
+#endif
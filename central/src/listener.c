@@ -0,0 +1,343 @@
+/** @file
+ *  @brief Connectionless keypress listener
+ *
+ *  Syncs to the periodic advertising trains of broadcasting peripherals
+ *  (see peripheral/src/broadcast.c). Every train repeats the last few
+ *  key edges; sequence numbers separate new edges from repeats and
+ *  reveal edges that fell out of the train before we heard them.
+ *
+ *  There is no return path to estimate the clock offset, so latency is
+ *  recorded relative to the fastest delivery seen on the train.
+ */
+
+/*
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <zephyr/types.h>
+#include <stddef.h>
+#include <string.h>
+#include <errno.h>
+#include <zephyr/zephyr.h>
+#include <zephyr/sys/printk.h>
+#include <zephyr/sys/byteorder.h>
+#include <zephyr/logging/log.h>
+
+#include <zephyr/bluetooth/bluetooth.h>
+#include <zephyr/bluetooth/uuid.h>
+
+#include "latency.h"
+#include "listener.h"
+#include "press_record.h"
+#include "vnd_uuid.h"
+
+LOG_MODULE_DECLARE(central, CONFIG_CENTRAL_LOG_LEVEL);
+
+#define STATS_INTERVAL_MS 5000
+
+static const uint8_t target_uuid[] = { BT_UUID_CUSTOM_SERVICE_KEY };
+
+struct listener_sync {
+	struct bt_le_per_adv_sync *sync;
+	bt_addr_le_t addr;
+	uint8_t sid;
+	uint16_t next_seq;
+	bool seq_valid;
+	/* Fastest arrival minus press time, offset included */
+	int32_t min_delay_us;
+	bool delay_valid;
+
+	int64_t window_start;
+	uint32_t events;
+	uint32_t received;
+	uint32_t repeats;
+	uint32_t lost;
+};
+
+static struct listener_sync syncs[CONFIG_BT_PER_ADV_SYNC_MAX];
+/* The controller creates one sync at a time; this one, if any */
+static struct listener_sync *creating;
+static listener_press_cb_t press_cb;
+
+/* An advertiser that goes away before the sync is established gets no
+ * callback at all, so give up on it after a while.
+ */
+static void create_timeout_handler(struct k_work *work)
+{
+	struct listener_sync *ls = creating;
+	int err;
+
+	if (!ls) {
+		return;
+	}
+
+	err = bt_le_per_adv_sync_delete(ls->sync);
+	if (err) {
+		printk("[LISTEN] sync create cancel failed (err %d)\n", err);
+	}
+
+	printk("[LISTEN] sync %u not established, giving up\n",
+	       (unsigned int)(ls - syncs));
+	memset(ls, 0, sizeof(*ls));
+	creating = NULL;
+}
+
+static K_WORK_DELAYABLE_DEFINE(create_timeout_work, create_timeout_handler);
+
+static void create_done(struct listener_sync *ls)
+{
+	if (ls && ls == creating) {
+		(void)k_work_cancel_delayable(&create_timeout_work);
+		creating = NULL;
+	}
+}
+
+static struct listener_sync *sync_lookup(const struct bt_le_per_adv_sync *sync)
+{
+	for (size_t i = 0; i < ARRAY_SIZE(syncs); i++) {
+		if (syncs[i].sync == sync) {
+			return &syncs[i];
+		}
+	}
+
+	return NULL;
+}
+
+static bool sync_known(const bt_addr_le_t *addr, uint8_t sid)
+{
+	for (size_t i = 0; i < ARRAY_SIZE(syncs); i++) {
+		if (syncs[i].sync && syncs[i].sid == sid &&
+		    !bt_addr_le_cmp(&syncs[i].addr, addr)) {
+			return true;
+		}
+	}
+
+	return false;
+}
+
+static void sync_stats_print(struct listener_sync *ls, int64_t now)
+{
+	printk("[LISTEN] sync %u: %u events, %u presses, %u repeats, %u lost\n",
+	       (unsigned int)(ls - syncs), ls->events, ls->received,
+	       ls->repeats, ls->lost);
+
+	ls->window_start = now;
+	ls->events = 0;
+	ls->received = 0;
+	ls->repeats = 0;
+	ls->lost = 0;
+}
+
+static void sync_records(struct listener_sync *ls, const uint8_t *data,
+			 uint8_t len)
+{
+	uint32_t arrival_us = press_clock_us(k_uptime_ticks());
+	uint32_t press_us;
+
+	if (len < PRESS_HEADER_SIZE ||
+	    (len - PRESS_HEADER_SIZE) % PRESS_RECORD_SIZE) {
+		return;
+	}
+
+	press_us = sys_get_le32(data);
+	data += PRESS_HEADER_SIZE;
+	len -= PRESS_HEADER_SIZE;
+
+	for (bool first = true; len;
+	     data += PRESS_RECORD_SIZE, len -= PRESS_RECORD_SIZE) {
+		struct press_record rec;
+		int16_t ahead;
+
+		press_record_decode(data, &rec);
+
+		/* The header stamps the first record, later ones follow by delta */
+		if (!first) {
+			press_us += rec.delta_ms * USEC_PER_MSEC;
+		}
+		first = false;
+
+		ahead = (int16_t)(rec.seq - ls->next_seq);
+		if (ls->seq_valid && ahead < 0) {
+			ls->repeats++;
+			continue;
+		}
+
+		if (ls->seq_valid && ahead > 0) {
+			ls->lost += ahead;
+			LOG_WRN("[GAP] sync %u missed %d presses",
+				(unsigned int)(ls - syncs), ahead);
+		}
+		ls->next_seq = rec.seq + 1;
+		ls->seq_valid = true;
+		ls->received++;
+
+		press_cb(rec.key, rec.down);
+
+		if (rec.down) {
+			int32_t delay_us = (int32_t)(arrival_us - press_us);
+
+			if (!ls->delay_valid || delay_us < ls->min_delay_us) {
+				ls->min_delay_us = delay_us;
+				ls->delay_valid = true;
+			}
+
+			latency_record(delay_us - ls->min_delay_us);
+		}
+	}
+}
+
+static bool svc_data_found(struct bt_data *data, void *user_data)
+{
+	struct listener_sync *ls = user_data;
+
+	if (data->type != BT_DATA_SVC_DATA128 ||
+	    data->data_len < BT_UUID_SIZE_128 ||
+	    memcmp(data->data, target_uuid, BT_UUID_SIZE_128)) {
+		return true;
+	}
+
+	sync_records(ls, &data->data[BT_UUID_SIZE_128],
+		     data->data_len - BT_UUID_SIZE_128);
+
+	return false;
+}
+
+static void sync_recv(struct bt_le_per_adv_sync *sync,
+		      const struct bt_le_per_adv_sync_recv_info *info,
+		      struct net_buf_simple *buf)
+{
+	struct listener_sync *ls = sync_lookup(sync);
+	int64_t now = k_uptime_get();
+
+	if (!ls) {
+		return;
+	}
+
+	ls->events++;
+	bt_data_parse(buf, svc_data_found, ls);
+
+	if (now - ls->window_start >= STATS_INTERVAL_MS) {
+		sync_stats_print(ls, now);
+	}
+}
+
+static void sync_synced(struct bt_le_per_adv_sync *sync,
+			struct bt_le_per_adv_sync_synced_info *info)
+{
+	struct listener_sync *ls = sync_lookup(sync);
+	char addr[BT_ADDR_LE_STR_LEN];
+
+	create_done(ls);
+
+	if (!ls) {
+		return;
+	}
+
+	bt_addr_le_to_str(info->addr, addr, sizeof(addr));
+	printk("[LISTEN] synced to %s, interval %u ms\n", addr,
+	       info->interval * 5U / 4U);
+
+	ls->window_start = k_uptime_get();
+}
+
+static void sync_term(struct bt_le_per_adv_sync *sync,
+		      const struct bt_le_per_adv_sync_term_info *info)
+{
+	struct listener_sync *ls = sync_lookup(sync);
+
+	create_done(ls);
+
+	if (!ls) {
+		return;
+	}
+
+	printk("[LISTEN] sync %u lost (reason 0x%02x)\n",
+	       (unsigned int)(ls - syncs), info->reason);
+	sync_stats_print(ls, k_uptime_get());
+	memset(ls, 0, sizeof(*ls));
+}
+
+static struct bt_le_per_adv_sync_cb sync_callbacks = {
+	.synced = sync_synced,
+	.term = sync_term,
+	.recv = sync_recv,
+};
+
+static bool uuid_found(struct bt_data *data, void *user_data)
+{
+	bool *found = user_data;
+
+	if (data->type != BT_DATA_UUID128_ALL &&
+	    data->type != BT_DATA_UUID128_SOME) {
+		return true;
+	}
+
+	for (uint8_t i = 0; i + BT_UUID_SIZE_128 <= data->data_len;
+	     i += BT_UUID_SIZE_128) {
+		if (!memcmp(&data->data[i], target_uuid, BT_UUID_SIZE_128)) {
+			*found = true;
+			return false;
+		}
+	}
+
+	return true;
+}
+
+static void scan_recv(const struct bt_le_scan_recv_info *info,
+		      struct net_buf_simple *buf)
+{
+	struct bt_le_per_adv_sync_param param = { 0 };
+	struct listener_sync *ls = NULL;
+	bool found = false;
+	int err;
+
+	/* Only extended advertising with a periodic train attached */
+	if (!info->interval || creating || sync_known(info->addr, info->sid)) {
+		return;
+	}
+
+	bt_data_parse(buf, uuid_found, &found);
+	if (!found) {
+		return;
+	}
+
+	for (size_t i = 0; i < ARRAY_SIZE(syncs); i++) {
+		if (!syncs[i].sync) {
+			ls = &syncs[i];
+			break;
+		}
+	}
+
+	if (!ls) {
+		return;
+	}
+
+	bt_addr_le_copy(&param.addr, info->addr);
+	param.sid = info->sid;
+	/* Give up after about five missed events, in 10 ms units */
+	param.timeout = CLAMP(info->interval * 5U / 8U, 100U, 0x4000U);
+
+	err = bt_le_per_adv_sync_create(&param, &ls->sync);
+	if (err) {
+		printk("[LISTEN] sync create failed (err %d)\n", err);
+		return;
+	}
+
+	bt_addr_le_copy(&ls->addr, info->addr);
+	ls->sid = info->sid;
+	creating = ls;
+	/* Two supervision timeouts; param.timeout is in 10 ms units */
+	k_work_schedule(&create_timeout_work, K_MSEC(param.timeout * 20U));
+}
+
+static struct bt_le_scan_cb scan_callbacks = {
+	.recv = scan_recv,
+};
+
+void listener_start(listener_press_cb_t cb)
+{
+	press_cb = cb;
+
+	bt_le_scan_cb_register(&scan_callbacks);
+	bt_le_per_adv_sync_cb_register(&sync_callbacks);
+}
@@ -0,0 +1,23 @@
+/** @file
+ *  @brief Connectionless keypress listener
+ */
+
+/*
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <zephyr/types.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Called once per key edge, however often the train repeats it */
+typedef void (*listener_press_cb_t)(uint8_t key, bool down);
+
+/* Sync to the press trains of peripherals found while scanning */
+void listener_start(listener_press_cb_t cb);
+
+#ifdef __cplusplus
+}
+#endif
@@ -8,6 +8,9 @@
 
 #include <zephyr/types.h>
 #include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
 #include <errno.h>
 #include <zephyr/zephyr.h>
 #include <zephyr/sys/printk.h>
@@ -18,16 +21,34 @@
 #include <zephyr/bluetooth/uuid.h>
 #include <zephyr/bluetooth/gatt.h>
 #include <zephyr/sys/byteorder.h>
+#include <zephyr/settings/settings.h>
+#include <zephyr/shell/shell.h>
+#include <zephyr/logging/log.h>
 
 #include <zephyr/drivers/gpio.h>
 
-#define BT_UUID_CUSTOM_SERVICE_KEY \
-	BT_UUID_128_ENCODE(0xDEADBEEF, 0xFEED, 0xBEEF, 0xF1D0, 0xFFFFFFFFFFFF)
-static const struct bt_uuid_128 SERVICE_UUID = BT_UUID_INIT_128(BT_UUID_CUSTOM_SERVICE_KEY);
+#include "ad_filter.h"
+#include "adv_cache.h"
+#include "conn_profile.h"
+#include "dedup.h"
+#include "event_bus.h"
+#include "frame_upload.h"
+#include "gatt_cache.h"
+#include "latency.h"
+#include "led_engine.h"
+#include "listener.h"
+#include "press_record.h"
+#include "relay.h"
+#include "time_sync.h"
+#include "vnd_uuid.h"
+
+LOG_MODULE_REGISTER(central, CONFIG_CENTRAL_LOG_LEVEL);
 
-#define BT_UUID_CUSTOM_SERVICE_PRESS \
-	BT_UUID_128_ENCODE(0x12345678, 0x1234, 0x5678, 0x1234, 0xEEEEEEEEEEEE)
+static const struct bt_uuid_128 SERVICE_UUID = BT_UUID_INIT_128(BT_UUID_CUSTOM_SERVICE_KEY);
 static const struct bt_uuid_128 PRESS_UUID = BT_UUID_INIT_128(BT_UUID_CUSTOM_SERVICE_PRESS);
+static const struct bt_uuid_128 CLOCK_UUID = BT_UUID_INIT_128(BT_UUID_CUSTOM_SERVICE_CLOCK);
+static const struct bt_uuid_128 SYNC_UUID = BT_UUID_INIT_128(BT_UUID_CUSTOM_SERVICE_SYNC);
+static const struct bt_uuid_128 RELAY_UUID = BT_UUID_INIT_128(BT_UUID_CUSTOM_SERVICE_RELAY);
 
 static const uint8_t *TARGET_UUID = ((uint8_t []) { BT_UUID_CUSTOM_SERVICE_KEY });
 
@@ -61,108 +82,867 @@ void configure_led(struct gpio_dt_spec l) {
 
 static void start_scan(void);
 
-static struct bt_conn *default_conn;
+/* Readings of the peripheral CLOCK characteristic kept per link */
+#define CLOCK_SYNC_SAMPLES 8
+/* Spacing of the first samples after subscribing */
+#define CLOCK_SYNC_FAST_MS 100
+
+struct clock_sample {
+	uint32_t rtt_us;
+	/* Central clock minus peripheral clock */
+	int32_t offset_us;
+};
+
+/* Per-connection state: every peripheral gets its own discovery chain
+ * and subscription so several can be serviced concurrently.
+ */
+struct central_link {
+	struct bt_conn *conn;
+	struct bt_uuid_16 discover_uuid;
+	struct bt_uuid_128 discover_big_uuid;
+	struct bt_gatt_discover_params discover_params;
+	struct bt_gatt_subscribe_params subscribe_params;
+	struct bt_gatt_read_params read_params;
+	/* Handles came from the GATT cache and await a Database Hash check */
+	bool validating;
+	/* Discovery waits for encryption, which resolves the peer's identity */
+	bool awaiting_security;
+	bool db_hash_valid;
+	uint8_t db_hash[GATT_CACHE_HASH_LEN];
+	uint32_t connected_at;
+	/* From connection create to connected, and on to subscribed */
+	uint32_t connect_ms;
+	uint32_t discovery_ms;
+	/* Sequence number expected in the next press record */
+	uint16_t next_seq;
+	bool seq_valid;
+	uint32_t lost;
+	uint32_t rx_notifications;
+	uint32_t rx_bytes;
+	uint32_t rx_presses;
+	/* Clock offset estimation, see clock_sync_handler() */
+	struct k_work_delayable sync_work;
+	struct bt_gatt_read_params sync_params;
+	uint32_t sync_sent_us;
+	struct clock_sample samples[CLOCK_SYNC_SAMPLES];
+	uint8_t sample_count;
+	uint8_t sample_next;
+	/* SYNC characteristic the good samples are written back to */
+	struct bt_gatt_discover_params sync_discover;
+	struct bt_uuid_128 sync_uuid;
+	uint16_t sync_handle;
+	bool sync_discovering;
+	bool sync_missing;
+	/* RELAY characteristic, only served by relay nodes */
+	struct bt_gatt_discover_params relay_discover;
+	struct bt_gatt_discover_params relay_ccc_discover;
+	struct bt_gatt_subscribe_params relay_subscribe;
+	struct bt_uuid_128 relay_uuid;
+	/* Clock sync and RELAY discovery run once per link, PRESS or not */
+	bool services_started;
+	uint32_t relay_records;
+	uint32_t relay_duplicates;
+	uint32_t relay_measured;
+	uint64_t relay_hop_us;
+	uint32_t relay_hop_max_us;
+	/* Cycles from publishing a key down to the LED toggle */
+	uint32_t led_count;
+	uint64_t led_cycles;
+	uint32_t led_max_cycles;
+};
+
+static struct central_link links[CONFIG_BT_MAX_CONN];
+
+/* Connection currently being created; only one can be pending at a time */
+static struct bt_conn *pending_conn;
+static uint32_t pending_since;
+
+static struct central_link *link_alloc(void)
+{
+	for (size_t i = 0; i < ARRAY_SIZE(links); i++) {
+		if (!links[i].conn) {
+			return &links[i];
+		}
+	}
+
+	return NULL;
+}
+
+static struct central_link *link_lookup(const struct bt_conn *conn)
+{
+	for (size_t i = 0; i < ARRAY_SIZE(links); i++) {
+		if (links[i].conn == conn) {
+			return &links[i];
+		}
+	}
+
+	return NULL;
+}
+
+static size_t link_count(void)
+{
+	size_t count = 0;
+
+	for (size_t i = 0; i < ARRAY_SIZE(links); i++) {
+		if (links[i].conn) {
+			count++;
+		}
+	}
+
+	return count;
+}
+
+static uint32_t central_clock_us(void)
+{
+	return press_clock_us(k_uptime_ticks());
+}
+
+/* The timebase every node's LED effects follow, see time_sync.h */
+static uint64_t shared_clock_us(void)
+{
+	return k_ticks_to_us_floor64(k_uptime_ticks());
+}
+
+/* The sample with the shortest round trip has the least asymmetric
+ * delay, so its offset is the best estimate.
+ */
+static bool link_clock_offset(const struct central_link *link, int32_t *offset_us)
+{
+	const struct clock_sample *best = NULL;
+
+	for (uint8_t i = 0; i < link->sample_count; i++) {
+		if (!best || link->samples[i].rtt_us < best->rtt_us) {
+			best = &link->samples[i];
+		}
+	}
+
+	if (best) {
+		*offset_us = best->offset_us;
+	}
+
+	return best != NULL;
+}
+
+static uint32_t link_min_rtt(const struct central_link *link)
+{
+	uint32_t rtt_us = UINT32_MAX;
+
+	for (uint8_t i = 0; i < link->sample_count; i++) {
+		rtt_us = MIN(rtt_us, link->samples[i].rtt_us);
+	}
+
+	return rtt_us;
+}
+
+static uint8_t sync_discover_func(struct bt_conn *conn,
+				  const struct bt_gatt_attr *attr,
+				  struct bt_gatt_discover_params *params)
+{
+	struct central_link *link = CONTAINER_OF(params, struct central_link,
+						 sync_discover);
+
+	link->sync_discovering = false;
+
+	if (!attr) {
+		printk("Peer has no SYNC, its LED effects run on its own clock\n");
+		link->sync_missing = true;
+		return BT_GATT_ITER_STOP;
+	}
+
+	link->sync_handle = ((struct bt_gatt_chrc *)attr->user_data)->value_handle;
+
+	return BT_GATT_ITER_STOP;
+}
+
+static void link_discover_sync(struct central_link *link)
+{
+	int err;
+
+	if (link->sync_discovering || link->sync_missing) {
+		return;
+	}
+
+	memcpy(&link->sync_uuid, &SYNC_UUID, sizeof(link->sync_uuid));
+	link->sync_discover.uuid = &link->sync_uuid.uuid;
+	link->sync_discover.func = sync_discover_func;
+	link->sync_discover.start_handle = BT_ATT_FIRST_ATTRIBUTE_HANDLE;
+	link->sync_discover.end_handle = BT_ATT_LAST_ATTRIBUTE_HANDLE;
+	link->sync_discover.type = BT_GATT_DISCOVER_CHARACTERISTIC;
+
+	err = bt_gatt_discover(link->conn, &link->sync_discover);
+	if (!err) {
+		link->sync_discovering = true;
+	}
+}
+
+/* Hand the peripheral one (its clock, shared clock) pair */
+static void link_send_sync(struct central_link *link, uint32_t peer_us,
+			   uint64_t shared_us)
+{
+	uint8_t msg[TIME_SYNC_SAMPLE_SIZE];
+	int err;
+
+	if (!link->sync_handle) {
+		link_discover_sync(link);
+		return;
+	}
+
+	msg[0] = TIME_SYNC_OP_SAMPLE;
+	sys_put_le32(peer_us, &msg[1]);
+	sys_put_le64(shared_us, &msg[5]);
+
+	err = bt_gatt_write_without_response(link->conn, link->sync_handle,
+					     msg, sizeof(msg), false);
+	if (err) {
+		printk("SYNC write failed (err %d)\n", err);
+	}
+}
+
+static uint8_t clock_read_func(struct bt_conn *conn, uint8_t err,
+			       struct bt_gatt_read_params *params,
+			       const void *data, uint16_t length)
+{
+	struct central_link *link = CONTAINER_OF(params, struct central_link,
+						 sync_params);
+	int64_t received = k_uptime_ticks();
+	uint32_t received_us = press_clock_us(received);
+
+	if (err) {
+		if (err == BT_ATT_ERR_ATTRIBUTE_NOT_FOUND) {
+			printk("Peer has no CLOCK, latency not measured\n");
+			return BT_GATT_ITER_STOP;
+		}
+	} else if (data && length == sizeof(uint32_t)) {
+		uint32_t rtt_us = received_us - link->sync_sent_us;
+		uint32_t peer_us = sys_get_le32(data);
+		struct clock_sample *sample = &link->samples[link->sample_next];
+
+		/* Assume the read was served halfway through the round trip */
+		sample->rtt_us = rtt_us;
+		sample->offset_us = (int32_t)(link->sync_sent_us + rtt_us / 2 - peer_us);
+
+		link->sample_next = (link->sample_next + 1) % CLOCK_SYNC_SAMPLES;
+		link->sample_count = MIN(link->sample_count + 1, CLOCK_SYNC_SAMPLES);
+
+		/* Slow round trips were delayed asymmetrically more often
+		 * than not; only pass on those close to the best one.
+		 */
+		if (rtt_us <= link_min_rtt(link) * 5U / 4U) {
+			link_send_sync(link, peer_us,
+				       k_ticks_to_us_floor64(received) - rtt_us / 2);
+		}
+	}
+
+	k_work_reschedule(&link->sync_work,
+			  K_MSEC(link->sample_count < CLOCK_SYNC_SAMPLES ?
+				 CLOCK_SYNC_FAST_MS :
+				 CONFIG_CENTRAL_CLOCK_SYNC_INTERVAL_MS));
+
+	return BT_GATT_ITER_STOP;
+}
+
+static void clock_sync_handler(struct k_work *work)
+{
+	struct central_link *link = CONTAINER_OF(k_work_delayable_from_work(work),
+						 struct central_link, sync_work);
+	int err;
+
+	link->sync_params.func = clock_read_func;
+	link->sync_params.handle_count = 0;
+	link->sync_params.by_uuid.start_handle = BT_ATT_FIRST_ATTRIBUTE_HANDLE;
+	link->sync_params.by_uuid.end_handle = BT_ATT_LAST_ATTRIBUTE_HANDLE;
+	link->sync_params.by_uuid.uuid = &CLOCK_UUID.uuid;
+
+	link->sync_sent_us = central_clock_us();
+	err = bt_gatt_read(link->conn, &link->sync_params);
+	if (err) {
+		printk("CLOCK read failed (err %d)\n", err);
+		k_work_reschedule(&link->sync_work,
+				  K_MSEC(CONFIG_CENTRAL_CLOCK_SYNC_INTERVAL_MS));
+	}
+}
+
+/* Key edges heard from peers go out on the event bus; led_work mirrors
+ * the presses on led1 and follows LED commands for the rest.
+ */
+static void led_work_handler(struct k_work *work);
+static K_WORK_DELAYABLE_DEFINE(led_work, led_work_handler);
+EVENT_SUB_DEFINE(led_sub, BIT(EVENT_CHAN_KEY) | BIT(EVENT_CHAN_LED), 8,
+		 &led_work);
+
+static const struct gpio_dt_spec *const leds[] = { &led_one, &led_two };
+
+static void led_key(const struct event *ev)
+{
+	struct central_link *link;
+	uint32_t cycles;
+	int err;
+
+	if (!ev->key.down) {
+		return;
+	}
+
+	/* Boards without the LED aliases, such as simulated ones */
+	if (led_two.port) {
+		err = gpio_pin_toggle_dt(&led_two);
+		if (err) {
+			LOG_ERR("LED Toggle failed (err 0x%02x)", err);
+		}
+	}
+
+	/* Listener presses come from no link */
+	if (!IS_ENABLED(CONFIG_CENTRAL_HOT_PATH_STATS) ||
+	    ev->key.source == KEY_SOURCE_NONE) {
+		return;
+	}
+
+	link = &links[ev->key.source];
+	if (!link->conn) {
+		return;
+	}
+
+	cycles = k_cycle_get_32() - ev->key.rx_cycles;
+	link->led_count++;
+	link->led_cycles += cycles;
+	link->led_max_cycles = MAX(link->led_max_cycles, cycles);
+}
+
+static void led_work_handler(struct k_work *work)
+{
+	const struct event *ev;
+
+	while ((ev = event_bus_get(&led_sub, K_NO_WAIT))) {
+		if (ev->chan == EVENT_CHAN_KEY) {
+			led_key(ev);
+		} else if (ev->chan == EVENT_CHAN_LED &&
+			   ev->led.led < ARRAY_SIZE(leds) &&
+			   leds[ev->led.led]->port) {
+			const struct gpio_dt_spec *led = leds[ev->led.led];
+			int err;
+
+			if (ev->led.op == LED_OP_TOGGLE) {
+				err = gpio_pin_toggle_dt(led);
+			} else {
+				err = gpio_pin_set_dt(led, ev->led.op == LED_OP_ON);
+			}
+			if (err) {
+				LOG_ERR("LED Set failed (err 0x%02x)", err);
+			}
+		}
+
+		event_bus_release(ev);
+	}
+}
 
-static struct bt_uuid_16 discover_uuid = BT_UUID_INIT_16(0);
-static struct bt_uuid_128 discover_big_uuid =  BT_UUID_INIT_128(BT_UUID_CUSTOM_SERVICE_KEY);
-static struct bt_gatt_discover_params discover_params;
-static struct bt_gatt_subscribe_params subscribe_params;
+static void key_publish(struct central_link *link, uint8_t key, bool down,
+			uint16_t seq, uint32_t rx_cycles)
+{
+	struct key_event evt = {
+		.timestamp = k_uptime_ticks(),
+		.rx_cycles = rx_cycles,
+		.seq = seq,
+		.source = link ? link - links : KEY_SOURCE_NONE,
+		.key = key,
+		.down = down,
+	};
+
+	(void)event_bus_publish_key(&evt);
+}
 
 static uint8_t notify_func(struct bt_conn *conn,
 			   struct bt_gatt_subscribe_params *params,
 			   const void *data, uint16_t length)
 {
+	/* Start of the hot path timed by CONFIG_CENTRAL_HOT_PATH_STATS */
+	uint32_t rx_cycles = k_cycle_get_32();
+
 	if (!data) {
-		printk("[UNSUBSCRIBED]\n");
+		LOG_INF("[UNSUBSCRIBED]");
 		params->value_handle = 0U;
 		return BT_GATT_ITER_STOP;
 	}
 
-	printk("[NOTIFICATION] data %p length %u\n", data, length);
-	int err = gpio_pin_toggle_dt(&led_two);
-	if (err) {
-		printk("LED Toggle failed (err 0x%02x)\n", err);
+	struct central_link *link = CONTAINER_OF(params, struct central_link,
+						 subscribe_params);
+	const uint8_t *rec_data = data;
+	uint32_t press_us, origin;
+	int32_t offset_us;
+	bool measure;
+
+	link->rx_notifications++;
+	link->rx_bytes += length;
+
+	if (length < PRESS_HEADER_SIZE ||
+	    (length - PRESS_HEADER_SIZE) % PRESS_RECORD_SIZE) {
+		LOG_WRN("[NOTIFICATION] link %u malformed length %u",
+			(unsigned int)(link - links), length);
+		return BT_GATT_ITER_CONTINUE;
+	}
+
+	if (IS_ENABLED(CONFIG_CONN_PROFILE)) {
+		conn_profile_activity(conn);
+	}
+
+	measure = link_clock_offset(link, &offset_us);
+	press_us = sys_get_le32(rec_data);
+	origin = sys_get_le32(&rec_data[4]);
+	rec_data += PRESS_HEADER_SIZE;
+	length -= PRESS_HEADER_SIZE;
+
+	for (bool first = true; length;
+	     rec_data += PRESS_RECORD_SIZE, length -= PRESS_RECORD_SIZE) {
+		struct press_record rec;
+
+		press_record_decode(rec_data, &rec);
+		link->rx_presses++;
+
+		if (link->seq_valid && rec.seq != link->next_seq) {
+			uint16_t missed = rec.seq - link->next_seq;
+
+			link->lost += missed;
+			LOG_WRN("[GAP] link %u missed %u presses (%u total)",
+				(unsigned int)(link - links), missed, link->lost);
+		}
+		link->next_seq = rec.seq + 1;
+		link->seq_valid = true;
+
+		/* The header stamps the first record, later ones follow by delta */
+		if (!first) {
+			press_us += rec.delta_ms * USEC_PER_MSEC;
+		}
+		first = false;
+
+		/* Already heard through a relay */
+		if (dedup_seen(origin, rec.seq)) {
+			continue;
+		}
+
+		if (IS_ENABLED(CONFIG_CENTRAL_RELAY)) {
+			struct press_relay_record fwd = {
+				.origin = origin,
+				.seq = rec.seq,
+				.key = rec.key,
+				.down = rec.down,
+				.ttl = CONFIG_CENTRAL_RELAY_TTL,
+			};
+
+			relay_forward(&fwd);
+		}
+
+		LOG_INF("[NOTIFICATION] link %u seq %u key %u %s +%u ms",
+			(unsigned int)(link - links), rec.seq, rec.key,
+			rec.down ? "down" : "up", rec.delta_ms);
+
+		key_publish(link, rec.key, rec.down, rec.seq, rx_cycles);
+
+		if (!rec.down) {
+			continue;
+		}
+
+		if (measure) {
+			int32_t latency_us = (int32_t)(central_clock_us() -
+						       press_us - offset_us);
+
+			latency_record(MAX(latency_us, 0));
+		}
 	}
 
 	return BT_GATT_ITER_CONTINUE;
 }
 
+static uint8_t relay_notify_func(struct bt_conn *conn,
+				 struct bt_gatt_subscribe_params *params,
+				 const void *data, uint16_t length)
+{
+	uint32_t rx_cycles = k_cycle_get_32();
+	struct central_link *link;
+	const uint8_t *rec_data = data;
+	uint32_t hop_us = 0;
+	int32_t offset_us;
+	bool measure;
+
+	if (!data) {
+		params->value_handle = 0U;
+		return BT_GATT_ITER_STOP;
+	}
+
+	link = CONTAINER_OF(params, struct central_link, relay_subscribe);
+
+	if (length < PRESS_RELAY_HEADER_SIZE ||
+	    (length - PRESS_RELAY_HEADER_SIZE) % PRESS_RELAY_RECORD_SIZE) {
+		LOG_WRN("[RELAYED] link %u malformed length %u",
+			(unsigned int)(link - links), length);
+		return BT_GATT_ITER_CONTINUE;
+	}
+
+	/* The relay stamps each notification as it sends it, so this is
+	 * the latency of the last hop only.
+	 */
+	measure = link_clock_offset(link, &offset_us);
+	if (measure) {
+		hop_us = MAX((int32_t)(central_clock_us() -
+				       sys_get_le32(rec_data) - offset_us), 0);
+	}
+	rec_data += PRESS_RELAY_HEADER_SIZE;
+	length -= PRESS_RELAY_HEADER_SIZE;
+
+	for (; length; rec_data += PRESS_RELAY_RECORD_SIZE,
+	     length -= PRESS_RELAY_RECORD_SIZE) {
+		struct press_relay_record rec;
+
+		press_relay_record_decode(rec_data, &rec);
+		link->relay_records++;
+
+		if (dedup_seen(rec.origin, rec.seq)) {
+			link->relay_duplicates++;
+			continue;
+		}
+
+		if (measure) {
+			link->relay_measured++;
+			link->relay_hop_us += hop_us;
+			link->relay_hop_max_us = MAX(link->relay_hop_max_us,
+						     hop_us);
+		}
+
+		LOG_INF("[RELAYED] link %u origin %08x seq %u key %u %s ttl %u",
+			(unsigned int)(link - links), rec.origin, rec.seq,
+			rec.key, rec.down ? "down" : "up", rec.ttl);
+
+		key_publish(link, rec.key, rec.down, rec.seq, rx_cycles);
+
+		if (IS_ENABLED(CONFIG_CENTRAL_RELAY) && rec.ttl > 1) {
+			rec.ttl--;
+			relay_forward(&rec);
+		}
+	}
+
+	return BT_GATT_ITER_CONTINUE;
+}
+
+static uint8_t relay_discover_func(struct bt_conn *conn,
+				   const struct bt_gatt_attr *attr,
+				   struct bt_gatt_discover_params *params)
+{
+	struct central_link *link = CONTAINER_OF(params, struct central_link,
+						 relay_discover);
+	int err;
+
+	/* Plain peripherals have keys of their own but nothing to relay */
+	if (!attr) {
+		return BT_GATT_ITER_STOP;
+	}
+
+	link->relay_subscribe.notify = relay_notify_func;
+	link->relay_subscribe.value = BT_GATT_CCC_NOTIFY;
+	link->relay_subscribe.value_handle =
+		((struct bt_gatt_chrc *)attr->user_data)->value_handle;
+	/* Let the stack find the CCC descriptor */
+	link->relay_subscribe.ccc_handle = 0;
+	link->relay_subscribe.end_handle = BT_ATT_LAST_ATTRIBUTE_HANDLE;
+	link->relay_subscribe.disc_params = &link->relay_ccc_discover;
+	atomic_set_bit(link->relay_subscribe.flags,
+		       BT_GATT_SUBSCRIBE_FLAG_VOLATILE);
+
+	err = bt_gatt_subscribe(conn, &link->relay_subscribe);
+	if (err && err != -EALREADY) {
+		LOG_ERR("RELAY subscribe failed (err %d)", err);
+	} else {
+		LOG_INF("[SUBSCRIBED] relay node on link %u",
+			(unsigned int)(link - links));
+	}
+
+	return BT_GATT_ITER_STOP;
+}
+
+static void link_discover_relay(struct central_link *link)
+{
+	int err;
+
+	memcpy(&link->relay_uuid, &RELAY_UUID, sizeof(link->relay_uuid));
+	link->relay_discover.uuid = &link->relay_uuid.uuid;
+	link->relay_discover.func = relay_discover_func;
+	link->relay_discover.start_handle = BT_ATT_FIRST_ATTRIBUTE_HANDLE;
+	link->relay_discover.end_handle = BT_ATT_LAST_ATTRIBUTE_HANDLE;
+	link->relay_discover.type = BT_GATT_DISCOVER_CHARACTERISTIC;
+
+	err = bt_gatt_discover(link->conn, &link->relay_discover);
+	if (err) {
+		printk("RELAY discovery failed (err %d)\n", err);
+	}
+}
+
+/* Peripherals serve PRESS and CLOCK, relay nodes RELAY and CLOCK; start
+ * whatever the peer has besides PRESS once PRESS is settled either way.
+ */
+static void link_services_start(struct central_link *link)
+{
+	if (link->services_started) {
+		return;
+	}
+
+	link->services_started = true;
+	k_work_reschedule(&link->sync_work, K_NO_WAIT);
+	link_discover_relay(link);
+}
+
+static void link_save_handles(struct central_link *link);
+
+static void link_subscribe(struct central_link *link)
+{
+	int err;
+
+	link->subscribe_params.notify = notify_func;
+	link->subscribe_params.value = BT_GATT_CCC_NOTIFY;
+	/* Slots are reused, so never let the stack keep params across links */
+	atomic_set_bit(link->subscribe_params.flags,
+		       BT_GATT_SUBSCRIBE_FLAG_VOLATILE);
+
+	err = bt_gatt_subscribe(link->conn, &link->subscribe_params);
+	if (err && err != -EALREADY) {
+		LOG_ERR("Subscribe failed (err %d)", err);
+	} else {
+		link->discovery_ms = k_uptime_get_32() - link->connected_at;
+		LOG_INF("[SUBSCRIBED] handle, %d, %u ms after connect",
+			link->subscribe_params.ccc_handle, link->discovery_ms);
+		link_services_start(link);
+
+		if (IS_ENABLED(CONFIG_LED_UPLOAD)) {
+			frame_upload_connect(link->conn);
+		}
+	}
+}
+
+static uint8_t discover_func(struct bt_conn *conn,
+			     const struct bt_gatt_attr *attr,
+			     struct bt_gatt_discover_params *params);
+
+/* UUID strings are only built when debug messages are compiled in */
+static void log_discover(const char *what, const struct bt_uuid *uuid)
+{
+	char str[BT_UUID_STR_LEN];
+
+	if (CONFIG_CENTRAL_LOG_LEVEL < LOG_LEVEL_DBG) {
+		return;
+	}
+
+	bt_uuid_to_str(uuid, str, sizeof(str));
+	LOG_DBG("[%s] UUID: %s", what, str);
+}
+
+static void link_discover(struct central_link *link)
+{
+	int err;
+
+	/* Copies the UUID type too; the slot was zeroed on last disconnect */
+	memcpy(&link->discover_big_uuid, &SERVICE_UUID, sizeof(link->discover_big_uuid));
+
+	log_discover("Discover Primary", &link->discover_big_uuid.uuid);
+	link->discover_params.uuid = &(link->discover_big_uuid.uuid);
+	link->discover_params.func = discover_func;
+	link->discover_params.start_handle = BT_ATT_FIRST_ATTRIBUTE_HANDLE;
+	link->discover_params.end_handle = BT_ATT_LAST_ATTRIBUTE_HANDLE;
+	link->discover_params.type = BT_GATT_DISCOVER_PRIMARY;
+
+	err = bt_gatt_discover(link->conn, &link->discover_params);
+	if (err) {
+		LOG_ERR("Discover failed (err %d)", err);
+	}
+}
+
+static void db_hash_done(struct central_link *link)
+{
+	struct gatt_cache_entry entry;
+
+	if (!link->validating) {
+		/* Hash read after a full discovery, remember the handles */
+		link_save_handles(link);
+		return;
+	}
+
+	link->validating = false;
+
+	if (IS_ENABLED(CONFIG_CENTRAL_GATT_CACHE)) {
+		if (link->db_hash_valid &&
+		    gatt_cache_find(bt_conn_get_dst(link->conn), &entry) &&
+		    !memcmp(entry.db_hash, link->db_hash, sizeof(entry.db_hash))) {
+			LOG_INF("[GATT CACHE] hit, skipping discovery");
+			link->subscribe_params.value_handle = entry.value_handle;
+			link->subscribe_params.ccc_handle = entry.ccc_handle;
+			link_subscribe(link);
+			return;
+		}
+
+		LOG_INF("[GATT CACHE] database changed, rediscovering");
+		gatt_cache_delete(bt_conn_get_dst(link->conn));
+	}
+
+	link_discover(link);
+}
+
+static uint8_t db_hash_read_func(struct bt_conn *conn, uint8_t err,
+				 struct bt_gatt_read_params *params,
+				 const void *data, uint16_t length)
+{
+	struct central_link *link = CONTAINER_OF(params, struct central_link,
+						 read_params);
+
+	if (!err && data && length == sizeof(link->db_hash)) {
+		memcpy(link->db_hash, data, sizeof(link->db_hash));
+		link->db_hash_valid = true;
+	} else if (err) {
+		printk("Database Hash read failed (err 0x%02x)\n", err);
+	}
+
+	db_hash_done(link);
+
+	return BT_GATT_ITER_STOP;
+}
+
+static void link_read_db_hash(struct central_link *link)
+{
+	int err;
+
+	link->db_hash_valid = false;
+	link->read_params.func = db_hash_read_func;
+	link->read_params.handle_count = 0;
+	link->read_params.by_uuid.start_handle = BT_ATT_FIRST_ATTRIBUTE_HANDLE;
+	link->read_params.by_uuid.end_handle = BT_ATT_LAST_ATTRIBUTE_HANDLE;
+	link->read_params.by_uuid.uuid = BT_UUID_GATT_DB_HASH;
+
+	err = bt_gatt_read(link->conn, &link->read_params);
+	if (err) {
+		printk("Database Hash read failed (err %d)\n", err);
+		db_hash_done(link);
+	}
+}
+
+static bool bond_found;
+
+static void bond_match(const struct bt_bond_info *info, void *user_data)
+{
+	if (!bt_addr_le_cmp(&info->addr, user_data)) {
+		bond_found = true;
+	}
+}
+
+static bool peer_is_bonded(const bt_addr_le_t *addr)
+{
+	bond_found = false;
+	bt_foreach_bond(BT_ID_DEFAULT, bond_match, (void *)addr);
+
+	return bond_found;
+}
+
+static void bond_count(const struct bt_bond_info *info, void *user_data)
+{
+	bond_found = true;
+}
+
+static bool bonds_exist(void)
+{
+	bond_found = false;
+	bt_foreach_bond(BT_ID_DEFAULT, bond_count, NULL);
+
+	return bond_found;
+}
+
+/* Handles are only worth keeping for peers that will come back bonded */
+static void link_save_handles(struct central_link *link)
+{
+	struct gatt_cache_entry entry;
+	int err;
+
+	if (!IS_ENABLED(CONFIG_CENTRAL_GATT_CACHE) ||
+	    !link->db_hash_valid || !link->subscribe_params.ccc_handle ||
+	    !peer_is_bonded(bt_conn_get_dst(link->conn))) {
+		return;
+	}
+
+	bt_addr_le_copy(&entry.addr, bt_conn_get_dst(link->conn));
+	memcpy(entry.db_hash, link->db_hash, sizeof(entry.db_hash));
+	entry.value_handle = link->subscribe_params.value_handle;
+	entry.ccc_handle = link->subscribe_params.ccc_handle;
+
+	err = gatt_cache_store(&entry);
+	if (err) {
+		printk("GATT cache store failed (err %d)\n", err);
+	}
+}
+
 static uint8_t discover_func(struct bt_conn *conn,
 			     const struct bt_gatt_attr *attr,
 			     struct bt_gatt_discover_params *params)
 {
-	printk("Discover called\n");
+	struct central_link *link = CONTAINER_OF(params, struct central_link,
+						 discover_params);
 	int err;
 
 	if (!attr) {
-		printk("Discover complete\n");
+		LOG_DBG("Discover complete");
 		(void)memset(params, 0, sizeof(*params));
+		/* No PRESS, as on a relay node: RELAY and CLOCK may still be */
+		link_services_start(link);
 		return BT_GATT_ITER_STOP;
 	}
 
-	char str[BT_UUID_STR_LEN];
-	bt_uuid_to_str(attr->uuid, str, sizeof(str));
-	printk("[PROCESSING] handle %u, uuid type: %02X, UUID: %s\n", attr->handle, attr->uuid->type, str);
-
-	if (!bt_uuid_cmp(discover_params.uuid,&SERVICE_UUID.uuid)) {
-		memcpy(discover_big_uuid.val, PRESS_UUID.val, sizeof(discover_big_uuid.val));
-		discover_params.uuid = &(discover_big_uuid.uuid);
-		discover_params.start_handle = attr->handle + 1;
-		discover_params.type = BT_GATT_DISCOVER_CHARACTERISTIC;
-
-		bt_uuid_to_str(discover_params.uuid, str, sizeof(str));
-		printk("[Discover Characteristic] UUID: %s\n", str);
-		err = bt_gatt_discover(conn, &discover_params);
+	LOG_DBG("[PROCESSING] handle %u, uuid type: %02X", attr->handle,
+		attr->uuid->type);
+	log_discover("PROCESSING", attr->uuid);
+
+	if (!bt_uuid_cmp(params->uuid, &SERVICE_UUID.uuid)) {
+		memcpy(link->discover_big_uuid.val, PRESS_UUID.val, sizeof(link->discover_big_uuid.val));
+		params->uuid = &(link->discover_big_uuid.uuid);
+		params->start_handle = attr->handle + 1;
+		params->type = BT_GATT_DISCOVER_CHARACTERISTIC;
+
+		log_discover("Discover Characteristic", params->uuid);
+		err = bt_gatt_discover(conn, params);
 		if (err) {
-			printk("Discover failed (err %d)\n", err);
+			LOG_ERR("Discover failed (err %d)", err);
 		}
-	} else if (!bt_uuid_cmp(discover_params.uuid,
+	} else if (!bt_uuid_cmp(params->uuid,
 				&PRESS_UUID.uuid)) {
-		memcpy(&discover_uuid, BT_UUID_GATT_CCC, sizeof(discover_uuid));
-		discover_params.uuid = &discover_uuid.uuid;
-		discover_params.start_handle = attr->handle + 2;
-		discover_params.type = BT_GATT_DISCOVER_DESCRIPTOR;
-		subscribe_params.value_handle = bt_gatt_attr_value_handle(attr);
-
-		bt_uuid_to_str(discover_params.uuid, str, sizeof(str));
-		printk("[Discover Descriptor] UUID: %s\n", str);
-		err = bt_gatt_discover(conn, &discover_params);
+		memcpy(&link->discover_uuid, BT_UUID_GATT_CCC, sizeof(link->discover_uuid));
+		params->uuid = &link->discover_uuid.uuid;
+		params->start_handle = attr->handle + 2;
+		params->type = BT_GATT_DISCOVER_DESCRIPTOR;
+		link->subscribe_params.value_handle = bt_gatt_attr_value_handle(attr);
+
+		log_discover("Discover Descriptor", params->uuid);
+		err = bt_gatt_discover(conn, params);
 		if (err) {
-			printk("Discover failed (err %d)\n", err);
+			LOG_ERR("Discover failed (err %d)", err);
 		}
-	} else if (!bt_uuid_cmp(discover_params.uuid, BT_UUID_HRS)) {
-		memcpy(&discover_uuid, BT_UUID_HRS_MEASUREMENT, sizeof(discover_uuid));
-		discover_params.uuid = &discover_uuid.uuid;
-		discover_params.start_handle = attr->handle + 1;
-		discover_params.type = BT_GATT_DISCOVER_CHARACTERISTIC;
+	} else if (!bt_uuid_cmp(params->uuid, BT_UUID_HRS)) {
+		memcpy(&link->discover_uuid, BT_UUID_HRS_MEASUREMENT, sizeof(link->discover_uuid));
+		params->uuid = &link->discover_uuid.uuid;
+		params->start_handle = attr->handle + 1;
+		params->type = BT_GATT_DISCOVER_CHARACTERISTIC;
 
-		printk("[Will Discover Heartbeat Characteristic]\n");
-		err = bt_gatt_discover(conn, &discover_params);
+		LOG_DBG("[Will Discover Heartbeat Characteristic]");
+		err = bt_gatt_discover(conn, params);
 		if (err) {
-			printk("Discover failed (err %d)\n", err);
+			LOG_ERR("Discover failed (err %d)", err);
 		}
-	} else if (!bt_uuid_cmp(discover_params.uuid,
+	} else if (!bt_uuid_cmp(params->uuid,
 				BT_UUID_HRS_MEASUREMENT)) {
-		memcpy(&discover_uuid, BT_UUID_GATT_CCC, sizeof(discover_uuid));
-		discover_params.uuid = &discover_uuid.uuid;
-		discover_params.start_handle = attr->handle + 2;
-		discover_params.type = BT_GATT_DISCOVER_DESCRIPTOR;
-		subscribe_params.value_handle = bt_gatt_attr_value_handle(attr);
+		memcpy(&link->discover_uuid, BT_UUID_GATT_CCC, sizeof(link->discover_uuid));
+		params->uuid = &link->discover_uuid.uuid;
+		params->start_handle = attr->handle + 2;
+		params->type = BT_GATT_DISCOVER_DESCRIPTOR;
+		link->subscribe_params.value_handle = bt_gatt_attr_value_handle(attr);
 
-		err = bt_gatt_discover(conn, &discover_params);
+		err = bt_gatt_discover(conn, params);
 		if (err) {
-			printk("Discover failed (err %d)\n", err);
+			LOG_ERR("Discover failed (err %d)", err);
 		}
 	} else {
-		subscribe_params.notify = notify_func;
-		subscribe_params.value = BT_GATT_CCC_NOTIFY;
-		subscribe_params.ccc_handle = attr->handle;
+		link->subscribe_params.ccc_handle = attr->handle;
+		link_subscribe(link);
 
-		err = bt_gatt_subscribe(conn, &subscribe_params);
-		if (err && err != -EALREADY) {
-			printk("Subscribe failed (err %d)\n", err);
-		} else {
-			printk("[SUBSCRIBED] handle, %d\n", subscribe_params.ccc_handle);
+		if (IS_ENABLED(CONFIG_CENTRAL_GATT_CACHE)) {
+			link_read_db_hash(link);
 		}
 
 		return BT_GATT_ITER_STOP;
@@ -171,13 +951,18 @@ static uint8_t discover_func(struct bt_conn *conn,
 	return BT_GATT_ITER_STOP;
 }
 
-static void device_found(const bt_addr_le_t *addr, int8_t rssi, uint8_t type,
-			 struct net_buf_simple *ad)
+/* Scanning is limited to missing bonded peripherals until this uptime */
+static int64_t reconnect_until;
+/* Set while the scan runs through the accept list */
+static bool scan_filtered;
+
+static void scan_report(const bt_addr_le_t *addr, int8_t rssi, uint8_t type,
+			struct net_buf_simple *ad)
 {
 	int err;
-	char addr_str[BT_ADDR_LE_STR_LEN];
 
-	if (default_conn) {
+	/* One connection is created at a time, and only while slots remain */
+	if (pending_conn || !link_alloc()) {
 		return;
 	}
 
@@ -187,64 +972,37 @@ static void device_found(const bt_addr_le_t *addr, int8_t rssi, uint8_t type,
 		return;
 	}
 
-	bt_addr_le_to_str(addr, addr_str, sizeof(addr_str));
-	// printk("\n\nDevice found: %s (RSSI %d)\n", addr_str, rssi);
-
-	// Extract Flag Metadata
-	uint8_t *ptr = ad->data;
-	uint8_t size = *ptr++;
-	uint8_t ad_type = *ptr++;
-	size--; //uint8_t flags[--size]; // -1 to remove type byte from size
-	
-	/* --- Process the Flags --- */
-	// memcpy(&flags, ptr, size);
-	// printk("flag split. size:%i, type: %02X, data:", size, ad_type, flags);
-	// for (int i = 0; i < size; i++)
-	// {
-	// 	if (i > 0) printf(":");
-	// 	printf("%02X", flags[i]);
-	// }
-	// printk("\n");
-
-
-	// Extract 16-bit Services Metadata
-	ptr += size;
-	size = *ptr++;
-	ad_type = *ptr++;
-	size--;// uint8_t services[--size]; // -1 to remove type byte from size
-
-	/* --- Process the 16bit services --- */
-	// memcpy(&services, ptr, size);
-	// printk("services split. size:%i, type: %02X, data:", size, ad_type, services);
-	// for (int i = 0; i < size; i++)
-	// {
-	// 	if (i > 0) printf(":");
-	// 	printf("%02X", services[i]);
-	// }
-	// printk("\n");
-
-	// Extract 128-bit Services Metadata
-	ptr += size;
-	size = *ptr++;
-	ad_type = *ptr++;
-	uint8_t big_uuids[--size]; // -1 to remove type byte from size
-
-	/* --- Process the 128bit services --- */
-	memcpy(&big_uuids, ptr, size);
-	// printk("big_uuids split. size:%i, type: %02X, data:", size, ad_type, big_uuids);
-	for (int i = 0; i < size; i++) {
-	// 	if (i > 0) printf(":");
-	// 	printf("%02X", big_uuids[i]);
-		if (big_uuids[i] != TARGET_UUID[i]) {
-			//printk("  -- ... doesn't match\n");
-			return;
+	/* The accept list and directed advertising only let our bonded
+	 * peripherals through; directed advertising carries no AD at all.
+	 */
+	bool known = scan_filtered || type == BT_GAP_ADV_TYPE_ADV_DIRECT_IND;
+
+	if (!known && IS_ENABLED(CONFIG_CENTRAL_ADV_CACHE) &&
+	    adv_cache_lookup(addr)) {
+		return;
+	}
+
+	if (!known && !ad_has_target(ad, TARGET_UUID)) {
+		if (IS_ENABLED(CONFIG_CENTRAL_ADV_CACHE)) {
+			adv_cache_add(addr, ADV_CACHE_REJECTED);
 		}
+		return;
 	}
-	// printk("\n");
 
-	printk("found a match, connecting\n");
+	LOG_DBG("found a match, connecting");
 	/* connect only to devices in close proximity */
 	if (rssi < -70) {
+		if (IS_ENABLED(CONFIG_CENTRAL_ADV_CACHE)) {
+			adv_cache_add(addr, ADV_CACHE_RSSI);
+		}
+		return;
+	}
+
+	/* Already linked to this peripheral */
+	struct bt_conn *conn = bt_conn_lookup_addr_le(BT_ID_DEFAULT, addr);
+
+	if (conn) {
+		bt_conn_unref(conn);
 		return;
 	}
 
@@ -252,103 +1010,459 @@ static void device_found(const bt_addr_le_t *addr, int8_t rssi, uint8_t type,
 		return;
 	}
 
+	pending_since = k_uptime_get_32();
 	err = bt_conn_le_create(addr, BT_CONN_LE_CREATE_CONN,
-				BT_LE_CONN_PARAM_DEFAULT, &default_conn);
+				BT_LE_CONN_PARAM_DEFAULT, &pending_conn);
 	if (err) {
-		printk("Create conn to %s failed (%u)\n", addr_str, err);
+		char addr_str[BT_ADDR_LE_STR_LEN];
+
+		bt_addr_le_to_str(addr, addr_str, sizeof(addr_str));
+		LOG_ERR("Create conn to %s failed (%u)", addr_str, err);
 		start_scan();
 	}
 }
 
 
+static void device_found(const bt_addr_le_t *addr, int8_t rssi, uint8_t type,
+			 struct net_buf_simple *ad)
+{
+	static uint32_t reports;
+	static uint64_t cycles;
+	uint32_t start;
+
+	/* Listeners take presses from periodic advertising, never connect */
+	if (IS_ENABLED(CONFIG_CENTRAL_LISTENER)) {
+		return;
+	}
+
+	if (CONFIG_CENTRAL_SCAN_STATS_INTERVAL == 0) {
+		scan_report(addr, rssi, type, ad);
+		return;
+	}
+
+	start = k_cycle_get_32();
+	scan_report(addr, rssi, type, ad);
+	cycles += k_cycle_get_32() - start;
+
+	if (++reports < CONFIG_CENTRAL_SCAN_STATS_INTERVAL) {
+		return;
+	}
+
+	uint32_t hits = 0, misses = 0;
+
+	if (IS_ENABLED(CONFIG_CENTRAL_ADV_CACHE)) {
+		adv_cache_stats(&hits, &misses);
+	}
+	LOG_INF("[SCAN] %u reports, %u cycles/report, cache hits %u misses %u",
+		reports, (uint32_t)(cycles / reports), hits, misses);
+	reports = 0;
+	cycles = 0;
+}
+
+/* When a link to a bonded peripheral dropped, to time its return */
+static struct {
+	bt_addr_le_t addr;
+	int64_t lost_at;
+} lost_peers[CONFIG_BT_MAX_CONN];
+
+static void scan_open_handler(struct k_work *work);
+static K_WORK_DELAYABLE_DEFINE(scan_open_work, scan_open_handler);
+
+static void bond_accept(const struct bt_bond_info *info, void *user_data)
+{
+	size_t *count = user_data;
+	struct bt_conn *conn = bt_conn_lookup_addr_le(BT_ID_DEFAULT, &info->addr);
+
+	if (conn) {
+		bt_conn_unref(conn);
+		return;
+	}
+
+	if (!bt_le_filter_accept_list_add(&info->addr)) {
+		(*count)++;
+	}
+}
+
+/* Put the bonded peripherals we are not connected to on the accept list */
+static size_t accept_list_fill(void)
+{
+	size_t count = 0;
+
+	if (!IS_ENABLED(CONFIG_CENTRAL_FAST_RECONNECT) ||
+	    k_uptime_get() >= reconnect_until) {
+		return 0;
+	}
+
+	/* The list can only change while the scanner is idle */
+	(void)bt_le_scan_stop();
+	(void)bt_le_filter_accept_list_clear();
+	bt_foreach_bond(BT_ID_DEFAULT, bond_accept, &count);
+
+	return count;
+}
+
 static void start_scan(void)
 {
+	struct bt_le_scan_param param = {
+		.type = BT_LE_SCAN_TYPE_PASSIVE,
+		.options = BT_LE_SCAN_OPT_FILTER_DUPLICATE,
+		.interval = BT_GAP_SCAN_FAST_INTERVAL,
+		.window = BT_GAP_SCAN_FAST_WINDOW,
+	};
 	int err;
-	err = bt_le_scan_start(BT_LE_SCAN_PASSIVE, device_found);
-	if (err) {
+
+	if (!link_alloc()) {
+		printk("All %d connection slots in use, not scanning\n",
+		       CONFIG_BT_MAX_CONN);
+		return;
+	}
+
+	bool filtered = accept_list_fill() > 0;
+
+	/* A running filtered scan would otherwise just carry on */
+	if (scan_filtered && !filtered) {
+		(void)bt_le_scan_stop();
+	}
+
+	scan_filtered = filtered;
+	if (scan_filtered) {
+		/* Scan continuously, high duty directed advertising is short */
+		param.options |= BT_LE_SCAN_OPT_FILTER_ACCEPT_LIST;
+		param.window = param.interval;
+		k_work_reschedule(&scan_open_work,
+				  K_TIMEOUT_ABS_MS(reconnect_until));
+	}
+
+	err = bt_le_scan_start(scan_filtered ? &param : BT_LE_SCAN_PASSIVE,
+			       device_found);
+	if (err == -EALREADY) {
+		return;
+	} else if (err) {
 		printk("Scanning failed to start (err %d)\n", err);
 		return;
 	}
 
-	printk("Scanning successfully started\n");
+	printk("Scanning successfully started%s\n",
+	       scan_filtered ? " for bonded peripherals" : "");
+}
+
+static void scan_open_handler(struct k_work *work)
+{
+	/* Reconnect window over: look for new peripherals again */
+	if (scan_filtered && !pending_conn) {
+		(void)bt_le_scan_stop();
+		start_scan();
+	}
 }
 
 static void connected(struct bt_conn *conn, uint8_t err)
 {
 	char addr[BT_ADDR_LE_STR_LEN];
+	struct central_link *link;
 
 	bt_addr_le_to_str(bt_conn_get_dst(conn), addr, sizeof(addr));
 
+	if (conn != pending_conn) {
+		return;
+	}
+
 	if (err) {
 		printk("Failed to connect to %s (%u)\n", addr, err);
 
-		bt_conn_unref(default_conn);
-		default_conn = NULL;
+		bt_conn_unref(pending_conn);
+		pending_conn = NULL;
 
 		start_scan();
 		return;
 	}
 
-	if (conn != default_conn) {
-		return;
+	/* Ownership of the reference moves from pending_conn to the link */
+	link = link_alloc();
+	link->conn = pending_conn;
+	link->connected_at = k_uptime_get_32();
+	link->connect_ms = link->connected_at - pending_since;
+	k_work_init_delayable(&link->sync_work, clock_sync_handler);
+	pending_conn = NULL;
+
+	(void)event_bus_publish_conn(bt_conn_index(conn), true, 0);
+	(void)event_bus_publish_led(0, LED_OP_ON);
+	printk("Connected: %s (%zu/%d links)\n\n", addr, link_count(),
+	       CONFIG_BT_MAX_CONN);
+
+	for (size_t i = 0; i < ARRAY_SIZE(lost_peers); i++) {
+		if (lost_peers[i].lost_at &&
+		    !bt_addr_le_cmp(&lost_peers[i].addr, bt_conn_get_dst(conn))) {
+			printk("[RECONNECT] %s back %u ms after disconnect\n",
+			       addr, (uint32_t)(k_uptime_get() -
+						lost_peers[i].lost_at));
+			lost_peers[i].lost_at = 0;
+		}
 	}
 
-	err = gpio_pin_set_dt(&led_one, 1);
-	if (err) {
-		printk("LED Set failed (err 0x%02x)\n", err);
+	if (IS_ENABLED(CONFIG_BT_SMP)) {
+		int ret = bt_conn_set_security(conn, BT_SECURITY_L2);
+		if (ret) {
+			printk("Failed to set security (err %d)\n", ret);
+		} else {
+			/* A bonded peer may be behind an RPA until encrypted */
+			link->awaiting_security =
+				IS_ENABLED(CONFIG_CENTRAL_GATT_CACHE) &&
+				bonds_exist();
+		}
 	}
-	printk("Connected: %s\n\n", addr);
 
-	memcpy(discover_big_uuid.val, SERVICE_UUID.val, sizeof(discover_big_uuid.val));
-	
-	char str[BT_UUID_STR_LEN];
-	bt_uuid_to_str(&discover_big_uuid.uuid, str, sizeof(str));
-	printk("[Discover Primary] UUID: %s\n", str);
-	discover_params.uuid = &(discover_big_uuid.uuid);
-	discover_params.func = discover_func;
-	discover_params.start_handle = BT_ATT_FIRST_ATTRIBUTE_HANDLE;
-	discover_params.end_handle = BT_ATT_LAST_ATTRIBUTE_HANDLE;
-	discover_params.type = BT_GATT_DISCOVER_PRIMARY;
-
-	err = bt_gatt_discover(default_conn, &discover_params);
-	if (err) {
-		printk("Discover failed(err %d)\n", err);
-		return;
+	if (!link->awaiting_security) {
+		link_discover(link);
 	}
+
+	/* Keep looking for peripherals while free slots remain */
+	start_scan();
 }
 
 static void disconnected(struct bt_conn *conn, uint8_t reason)
 {
 	char addr[BT_ADDR_LE_STR_LEN];
+	struct central_link *link = link_lookup(conn);
 
-	if (conn != default_conn) {
+	if (!link) {
 		return;
 	}
 
 	bt_addr_le_to_str(bt_conn_get_dst(conn), addr, sizeof(addr));
 
 	printk("Disconnected: %s (reason 0x%02x)\n", addr, reason);
-	int err = gpio_pin_set_dt(&led_one, 0);
-	if (err) {
-		printk("LED Set failed (err 0x%02x)\n", err);
+
+	uint32_t up_ms = MAX(k_uptime_get_32() - link->connected_at, 1U);
+
+	printk("Link carried %u notifications, %u bytes in %u ms (%u B/s), "
+	       "%u presses lost\n", link->rx_notifications, link->rx_bytes,
+	       up_ms, (uint32_t)((uint64_t)link->rx_bytes * MSEC_PER_SEC / up_ms),
+	       link->lost);
+
+	if (link->relay_records) {
+		uint32_t checked, duplicates;
+
+		dedup_stats(&checked, &duplicates);
+		printk("Relay link carried %u records, %u duplicates, "
+		       "hop avg %u us max %u us; %u of %u presses were "
+		       "duplicates overall\n",
+		       link->relay_records, link->relay_duplicates,
+		       (uint32_t)(link->relay_hop_us /
+				  MAX(link->relay_measured, 1U)),
+		       link->relay_hop_max_us, duplicates, checked);
 	}
 
-	bt_conn_unref(default_conn);
-	default_conn = NULL;
+	if (IS_ENABLED(CONFIG_CENTRAL_HOT_PATH_STATS) && link->led_count) {
+		printk("Notification to LED took avg %u us max %u us over "
+		       "%u presses\n",
+		       k_cyc_to_us_floor32(link->led_cycles / link->led_count),
+		       k_cyc_to_us_floor32(link->led_max_cycles),
+		       link->led_count);
+	}
 
-	start_scan();
+	if (IS_ENABLED(CONFIG_CENTRAL_FAST_RECONNECT)) {
+		size_t slot = link - links;
+
+		bt_addr_le_copy(&lost_peers[slot].addr, bt_conn_get_dst(conn));
+		lost_peers[slot].lost_at = k_uptime_get();
+		reconnect_until = k_uptime_get() +
+				  CONFIG_CENTRAL_FAST_RECONNECT_MS;
+	}
+
+	struct k_work_sync sync;
+
+	k_work_cancel_delayable_sync(&link->sync_work, &sync);
+	bt_conn_unref(link->conn);
+	(void)memset(link, 0, sizeof(*link));
+
+	(void)event_bus_publish_conn(bt_conn_index(conn), false, reason);
+	if (!link_count()) {
+		(void)event_bus_publish_led(0, LED_OP_OFF);
+	}
+
+	/* A slot was freed; scanning may have stopped when the table filled */
+	if (!pending_conn) {
+		start_scan();
+	}
 }
 
+#if defined(CONFIG_BT_SMP)
+static void security_changed(struct bt_conn *conn, bt_security_t level,
+			     enum bt_security_err err)
+{
+	struct central_link *link = link_lookup(conn);
+	struct gatt_cache_entry entry;
+
+	if (!link || !link->awaiting_security) {
+		return;
+	}
+
+	link->awaiting_security = false;
+
+	/* The destination is the identity address once the bond is used */
+	if (!err && gatt_cache_find(bt_conn_get_dst(conn), &entry)) {
+		/* Known peer: one Database Hash read instead of the whole chain */
+		link->validating = true;
+		link_read_db_hash(link);
+	} else {
+		link_discover(link);
+	}
+}
+#endif
+
 BT_CONN_CB_DEFINE(conn_callbacks) = {
 	.connected = connected,
 	.disconnected = disconnected,
+#if defined(CONFIG_BT_SMP)
+	.security_changed = security_changed,
+#endif
 };
 
+static void pairing_complete(struct bt_conn *conn, bool bonded)
+{
+	struct central_link *link = link_lookup(conn);
+
+	printk("Pairing complete (bonded %d)\n", bonded);
+
+	/* The Database Hash may have been read before the bond existed */
+	if (link && bonded) {
+		link_save_handles(link);
+	}
+}
+
+static void bond_deleted(uint8_t id, const bt_addr_le_t *peer)
+{
+	if (IS_ENABLED(CONFIG_CENTRAL_GATT_CACHE)) {
+		gatt_cache_delete(peer);
+	}
+}
+
+static struct bt_conn_auth_info_cb auth_info_callbacks = {
+	.pairing_complete = pairing_complete,
+	.bond_deleted = bond_deleted,
+};
+
+static void listener_press(uint8_t key, bool down)
+{
+	LOG_INF("[BROADCAST] key %u %s", key, down ? "down" : "up");
+
+	key_publish(NULL, key, down, 0, 0);
+}
+
+#if defined(CONFIG_SHELL)
+static int cmd_effect(const struct shell *sh, size_t argc, char **argv)
+{
+	uint64_t at_us = shared_clock_us() +
+			 CONFIG_CENTRAL_EFFECT_LEAD_MS * USEC_PER_MSEC;
+	uint8_t msg[TIME_SYNC_EFFECT_SIZE];
+	unsigned long effect;
+	char *end;
+	int sent = 0;
+
+	effect = strtoul(argv[1], &end, 0);
+	if (end == argv[1] || *end || effect >= LED_EFFECT_COUNT) {
+		shell_error(sh, "Effect must be 0 to %d", LED_EFFECT_COUNT - 1);
+		return -EINVAL;
+	}
+
+	msg[0] = TIME_SYNC_OP_EFFECT;
+	sys_put_le64(at_us, &msg[1]);
+	msg[9] = effect;
+
+	for (size_t i = 0; i < ARRAY_SIZE(links); i++) {
+		struct central_link *link = &links[i];
+
+		if (!link->conn || !link->sync_handle) {
+			continue;
+		}
+
+		if (!bt_gatt_write_without_response(link->conn,
+						    link->sync_handle, msg,
+						    sizeof(msg), false)) {
+			sent++;
+		}
+	}
+
+	shell_print(sh, "Effect %u at %llu us on %d nodes", msg[9],
+		    (unsigned long long)at_us, sent);
+
+	return 0;
+}
+
+SHELL_CMD_ARG_REGISTER(effect, NULL,
+		       "Switch every synced node to an LED effect at once",
+		       cmd_effect, 2, 0);
+#endif /* CONFIG_SHELL */
+
+#if CONFIG_CENTRAL_BENCH_REPORT_S
+static void bench_report_handler(struct k_work *work);
+static K_WORK_DELAYABLE_DEFINE(bench_report_work, bench_report_handler);
+
+/* Longest report header and link object, every number at 10 digits */
+#define BENCH_HEADER_MAX 128
+#define BENCH_LINK_MAX 208
+
+/* One JSON object per line, prefixed so it can be picked out of the log.
+ * Formatted whole and printed at once, so other output never lands in
+ * the middle of it.
+ */
+static void bench_report_handler(struct k_work *work)
+{
+	static char report[BENCH_HEADER_MAX +
+			   CONFIG_BT_MAX_CONN * BENCH_LINK_MAX];
+	uint32_t count, p50_us, p99_us, max_us;
+	uint32_t now = k_uptime_get_32();
+	bool first = true;
+	size_t len;
+
+	latency_summary(&count, &p50_us, &p99_us, &max_us);
+
+	len = snprintf(report, sizeof(report),
+		       "BENCH {\"uptime_ms\":%u,\"latency_us\":{\"count\":%u,"
+		       "\"p50\":%u,\"p99\":%u,\"max\":%u},\"links\":[",
+		       now, count, p50_us, p99_us, max_us);
+
+	for (size_t i = 0; i < ARRAY_SIZE(links); i++) {
+		struct central_link *link = &links[i];
+		uint32_t up_ms;
+
+		if (!link->conn) {
+			continue;
+		}
+
+		up_ms = MAX(now - link->connected_at, 1U);
+		len += snprintf(&report[len], sizeof(report) - len,
+				"%s{\"link\":%u,\"connect_ms\":%u,"
+				"\"discovery_ms\":%u,\"notifications\":%u,"
+				"\"presses\":%u,\"lost\":%u,\"relayed\":%u,"
+				"\"bytes\":%u,\"throughput_Bps\":%u}",
+				first ? "" : ",", (unsigned int)i,
+				link->connect_ms, link->discovery_ms,
+				link->rx_notifications, link->rx_presses,
+				link->lost, link->relay_records, link->rx_bytes,
+				(uint32_t)((uint64_t)link->rx_bytes *
+					   MSEC_PER_SEC / up_ms));
+		first = false;
+	}
+
+	snprintf(&report[len], sizeof(report) - len, "]}\n");
+	printk("%s", report);
+
+	if (IS_ENABLED(CONFIG_CENTRAL_BENCH_HISTOGRAM)) {
+		latency_print(NULL);
+	}
+
+	k_work_schedule(&bench_report_work,
+			K_SECONDS(CONFIG_CENTRAL_BENCH_REPORT_S));
+}
+#endif /* CONFIG_CENTRAL_BENCH_REPORT_S */
+
 void main(void)
 {
 	int err;
 	configure_led(led_one);
 	configure_led(led_two);
+	event_bus_subscribe(&led_sub);
 
 	err = bt_enable(NULL);
 	if (err) {
@@ -358,5 +1472,29 @@ void main(void)
 
 	printk("Bluetooth initialized\n");
 
+	if (IS_ENABLED(CONFIG_BT_SMP)) {
+		bt_conn_auth_info_cb_register(&auth_info_callbacks);
+	}
+
+	if (IS_ENABLED(CONFIG_SETTINGS)) {
+		settings_load();
+	}
+
+	if (IS_ENABLED(CONFIG_CENTRAL_LISTENER)) {
+		listener_start(listener_press);
+	}
+
+	if (IS_ENABLED(CONFIG_CENTRAL_RELAY)) {
+		relay_start();
+	}
+
+#if CONFIG_CENTRAL_BENCH_REPORT_S
+	k_work_schedule(&bench_report_work,
+			K_SECONDS(CONFIG_CENTRAL_BENCH_REPORT_S));
+#endif
+
+	/* Bonded peripherals are likely advertising for us after a reset */
+	reconnect_until = k_uptime_get() + CONFIG_CENTRAL_FAST_RECONNECT_MS;
+
 	start_scan();
 }
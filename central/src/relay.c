@@ -0,0 +1,269 @@
+/** @file
+ *  @brief Relay role: forward presses to an upstream central
+ *
+ *  A relay is a central towards its own peripherals and a peripheral
+ *  towards the next node up the tree. It serves the vendor service with
+ *  a RELAY characteristic carrying every new press it hears, tagged
+ *  with origin and remaining TTL (see press_record.h), and a CLOCK so the
+ *  upstream node can measure the latency of this hop.
+ */
+
+/*
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <zephyr/types.h>
+#include <stddef.h>
+#include <string.h>
+#include <errno.h>
+#include <zephyr/zephyr.h>
+#include <zephyr/sys/printk.h>
+#include <zephyr/sys/byteorder.h>
+
+#include <zephyr/bluetooth/bluetooth.h>
+#include <zephyr/bluetooth/hci.h>
+#include <zephyr/bluetooth/conn.h>
+#include <zephyr/bluetooth/uuid.h>
+#include <zephyr/bluetooth/gatt.h>
+
+#include "press_record.h"
+#include "relay.h"
+#include "vnd_uuid.h"
+
+static const struct bt_uuid_128 service_uuid = BT_UUID_INIT_128(BT_UUID_CUSTOM_SERVICE_KEY);
+static const struct bt_uuid_128 clock_uuid = BT_UUID_INIT_128(BT_UUID_CUSTOM_SERVICE_CLOCK);
+static const struct bt_uuid_128 relay_uuid = BT_UUID_INIT_128(BT_UUID_CUSTOM_SERVICE_RELAY);
+
+/* Largest ATT payload with the default LE Data Length maximum MTU */
+#define RELAY_NOTIFY_MAX 244
+/* Retry spacing when the stack is out of buffers */
+#define RELAY_RETRY_MS 10
+
+struct relay_item {
+	struct press_relay_record rec;
+	int64_t received;
+};
+
+K_MSGQ_DEFINE(relay_msgq, sizeof(struct relay_item),
+	      CONFIG_CENTRAL_RELAY_QUEUE_SIZE, 4);
+
+static void relay_work_handler(struct k_work *work);
+static K_WORK_DELAYABLE_DEFINE(relay_work, relay_work_handler);
+
+static void adv_work_handler(struct k_work *work);
+static K_WORK_DEFINE(adv_work, adv_work_handler);
+
+/* Link to the next node up the tree, we are its peripheral */
+static struct bt_conn *upstream;
+
+static struct {
+	uint32_t forwarded;
+	uint32_t overflowed;
+	uint32_t failed;
+	/* Heard while no upstream node was connected */
+	uint32_t dropped;
+	uint64_t residence_us;
+	uint32_t residence_max_us;
+} relay_stats;
+
+static ssize_t read_clock(struct bt_conn *conn, const struct bt_gatt_attr *attr,
+			  void *buf, uint16_t len, uint16_t offset)
+{
+	uint8_t now[sizeof(uint32_t)];
+
+	sys_put_le32(press_clock_us(k_uptime_ticks()), now);
+
+	return bt_gatt_attr_read(conn, attr, buf, len, offset, now,
+				 sizeof(now));
+}
+
+static void relay_ccc_cfg_changed(const struct bt_gatt_attr *attr,
+				  uint16_t value)
+{
+	printk("[RELAY] upstream %s\n",
+	       value == BT_GATT_CCC_NOTIFY ? "subscribed" : "unsubscribed");
+}
+
+BT_GATT_SERVICE_DEFINE(relay_svc,
+	BT_GATT_PRIMARY_SERVICE(&service_uuid.uuid),
+	BT_GATT_CHARACTERISTIC(&relay_uuid.uuid, BT_GATT_CHRC_NOTIFY,
+			       BT_GATT_PERM_NONE, NULL, NULL, NULL),
+	BT_GATT_CCC(relay_ccc_cfg_changed,
+		    BT_GATT_PERM_READ | BT_GATT_PERM_WRITE),
+	BT_GATT_CHARACTERISTIC(&clock_uuid.uuid, BT_GATT_CHRC_READ,
+			       BT_GATT_PERM_READ, read_clock, NULL, NULL),
+);
+
+static const struct bt_data ad[] = {
+	BT_DATA_BYTES(BT_DATA_FLAGS, (BT_LE_AD_GENERAL | BT_LE_AD_NO_BREDR)),
+	BT_DATA_BYTES(BT_DATA_UUID128_ALL, BT_UUID_CUSTOM_SERVICE_KEY),
+};
+
+static void relay_work_handler(struct k_work *work)
+{
+	static uint8_t buf[RELAY_NOTIFY_MAX];
+	static size_t buf_len;
+	struct relay_item item;
+	int err;
+
+	if (!upstream) {
+		relay_stats.dropped += k_msgq_num_used_get(&relay_msgq);
+		k_msgq_purge(&relay_msgq);
+		buf_len = 0;
+		return;
+	}
+
+	do {
+		/* 3 bytes of ATT opcode and handle */
+		size_t max = MIN(sizeof(buf), bt_gatt_get_mtu(upstream) - 3);
+
+		while (MAX(buf_len, PRESS_RELAY_HEADER_SIZE) +
+		       PRESS_RELAY_RECORD_SIZE <= max &&
+		       !k_msgq_get(&relay_msgq, &item, K_NO_WAIT)) {
+			uint32_t us = k_ticks_to_us_floor32(k_uptime_ticks() -
+							    item.received);
+
+			if (!buf_len) {
+				buf_len = PRESS_RELAY_HEADER_SIZE;
+			}
+
+			press_relay_record_encode(&item.rec, &buf[buf_len]);
+			buf_len += PRESS_RELAY_RECORD_SIZE;
+
+			relay_stats.residence_us += us;
+			relay_stats.residence_max_us =
+				MAX(relay_stats.residence_max_us, us);
+		}
+
+		if (!buf_len) {
+			break;
+		}
+
+		/* Stamped at send time, so upstream measures only this hop */
+		sys_put_le32(press_clock_us(k_uptime_ticks()), buf);
+
+		err = bt_gatt_notify(upstream, &relay_svc.attrs[2], buf, buf_len);
+		if (err == -ENOMEM) {
+			k_work_schedule(&relay_work, K_MSEC(RELAY_RETRY_MS));
+			break;
+		}
+
+		if (err) {
+			relay_stats.failed += (buf_len -
+					       PRESS_RELAY_HEADER_SIZE) /
+					      PRESS_RELAY_RECORD_SIZE;
+		} else {
+			relay_stats.forwarded += (buf_len -
+						  PRESS_RELAY_HEADER_SIZE) /
+						 PRESS_RELAY_RECORD_SIZE;
+		}
+
+		buf_len = 0;
+	} while (k_msgq_num_used_get(&relay_msgq));
+}
+
+void relay_forward(const struct press_relay_record *rec)
+{
+	struct relay_item item = {
+		.rec = *rec,
+		.received = k_uptime_ticks(),
+	};
+
+	if (k_msgq_put(&relay_msgq, &item, K_NO_WAIT)) {
+		relay_stats.overflowed++;
+		return;
+	}
+
+	k_work_schedule(&relay_work, K_NO_WAIT);
+}
+
+/* Only one node up the tree: advertising stops at the first connection
+ * and resumes when that upstream link is gone.
+ */
+#define RELAY_ADV_PARAM BT_LE_ADV_PARAM(BT_LE_ADV_OPT_CONNECTABLE |	\
+					BT_LE_ADV_OPT_ONE_TIME |	\
+					BT_LE_ADV_OPT_USE_NAME,		\
+					BT_GAP_ADV_FAST_INT_MIN_2,	\
+					BT_GAP_ADV_FAST_INT_MAX_2, NULL)
+
+static void adv_work_handler(struct k_work *work)
+{
+	int err;
+
+	err = bt_le_adv_start(RELAY_ADV_PARAM, ad, ARRAY_SIZE(ad), NULL, 0);
+	if (err && err != -EALREADY) {
+		printk("[RELAY] advertising failed to start (err %d)\n", err);
+	}
+}
+
+static bool is_upstream(struct bt_conn *conn)
+{
+	struct bt_conn_info info;
+
+	return !bt_conn_get_info(conn, &info) &&
+	       info.role == BT_CONN_ROLE_PERIPHERAL;
+}
+
+static void relay_connected(struct bt_conn *conn, uint8_t err)
+{
+	if (!is_upstream(conn)) {
+		return;
+	}
+
+	if (err) {
+		/* Advertising ended with the failed attempt */
+		if (!upstream) {
+			k_work_submit(&adv_work);
+		}
+		return;
+	}
+
+	/* Advertising should have stopped; never let a second node take
+	 * over or share the upstream role.
+	 */
+	if (upstream) {
+		printk("[RELAY] extra upstream rejected\n");
+		(void)bt_conn_disconnect(conn,
+					 BT_HCI_ERR_REMOTE_USER_TERM_CONN);
+		return;
+	}
+
+	printk("[RELAY] upstream connected\n");
+	upstream = bt_conn_ref(conn);
+}
+
+static void relay_disconnected(struct bt_conn *conn, uint8_t reason)
+{
+	uint32_t count;
+
+	if (conn != upstream) {
+		return;
+	}
+
+	bt_conn_unref(upstream);
+	upstream = NULL;
+
+	count = MAX(relay_stats.forwarded, 1U);
+	printk("[RELAY] upstream lost: %u forwarded, %u overflowed, %u failed, "
+	       "%u dropped, residence avg %u us max %u us\n",
+	       relay_stats.forwarded, relay_stats.overflowed,
+	       relay_stats.failed, relay_stats.dropped,
+	       (uint32_t)(relay_stats.residence_us / count),
+	       relay_stats.residence_max_us);
+	memset(&relay_stats, 0, sizeof(relay_stats));
+
+	/* The connection object is only released after this callback */
+	k_work_submit(&adv_work);
+}
+
+BT_CONN_CB_DEFINE(relay_conn_callbacks) = {
+	.connected = relay_connected,
+	.disconnected = relay_disconnected,
+};
+
+int relay_start(void)
+{
+	k_work_submit(&adv_work);
+
+	return 0;
+}
@@ -0,0 +1,25 @@
+/** @file
+ *  @brief Relay role: forward presses to an upstream central
+ */
+
+/*
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <zephyr/types.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+struct press_relay_record;
+
+/* Start advertising the vendor service to upstream centrals */
+int relay_start(void);
+
+/* Queue a record, ttl already decremented, for the upstream link */
+void relay_forward(const struct press_relay_record *rec);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,197 @@
+/** @file
+ *  @brief Connection parameter profiles
+ *
+ *  Tracks every LE connection through its own connection callbacks, so
+ *  an application only reports key activity. Parameter updates are
+ *  requested from the system work queue since they wait for the
+ *  controller. The profile a link is in is taken from the parameters
+ *  reported by le_param_updated, so a rejected or overridden request
+ *  does not leave it recorded as applied.
+ */
+
+/*
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <zephyr/types.h>
+#include <stddef.h>
+#include <errno.h>
+#include <zephyr/zephyr.h>
+#include <zephyr/sys/printk.h>
+
+#include <zephyr/bluetooth/bluetooth.h>
+#include <zephyr/bluetooth/conn.h>
+
+#include "conn_profile.h"
+
+static const struct bt_le_conn_param profiles[] = {
+	/* 7.5 ms, every connection event is used */
+	[CONN_PROFILE_ACTIVE] = BT_LE_CONN_PARAM_INIT(6, 6, 0, 400),
+	/* 100 ms, the peripheral may sleep through 4 events in a row */
+	[CONN_PROFILE_IDLE] = BT_LE_CONN_PARAM_INIT(80, 80, 4, 600),
+};
+
+static const char *const profile_names[] = {
+	[CONN_PROFILE_ACTIVE] = "active",
+	[CONN_PROFILE_IDLE] = "idle",
+};
+
+struct profile_state {
+	struct bt_conn *conn;
+	/* Profile the link's current parameters match */
+	enum conn_profile profile;
+	/* Update requested but not yet reported by le_param_updated */
+	bool pending;
+	enum conn_profile requested;
+	struct k_work active_work;
+	struct k_work_delayable idle_work;
+};
+
+static struct profile_state states[CONFIG_BT_MAX_CONN];
+
+static void profile_set(struct profile_state *state, enum conn_profile profile)
+{
+	int err;
+
+	if (!state->conn) {
+		return;
+	}
+
+	if (state->pending ? state->requested == profile :
+			     state->profile == profile) {
+		return;
+	}
+
+	err = bt_conn_le_param_update(state->conn, &profiles[profile]);
+	if (err) {
+		printk("[CONN PROFILE] %s request failed (err %d)\n",
+		       profile_names[profile], err);
+		return;
+	}
+
+	/* The link only changes once the update procedure completes */
+	state->pending = true;
+	state->requested = profile;
+}
+
+static enum conn_profile profile_match(uint16_t interval, uint16_t latency)
+{
+	for (size_t i = 0; i < ARRAY_SIZE(profiles); i++) {
+		if (interval >= profiles[i].interval_min &&
+		    interval <= profiles[i].interval_max &&
+		    latency == profiles[i].latency) {
+			return i;
+		}
+	}
+
+	/* Anything else is too slow for key activity */
+	return CONN_PROFILE_IDLE;
+}
+
+static void active_work_handler(struct k_work *work)
+{
+	profile_set(CONTAINER_OF(work, struct profile_state, active_work),
+		    CONN_PROFILE_ACTIVE);
+}
+
+static void idle_work_handler(struct k_work *work)
+{
+	profile_set(CONTAINER_OF(k_work_delayable_from_work(work),
+				 struct profile_state, idle_work),
+		    CONN_PROFILE_IDLE);
+}
+
+static void activity(struct bt_conn *conn, void *data)
+{
+	struct profile_state *state = &states[bt_conn_index(conn)];
+
+	if (!state->conn) {
+		return;
+	}
+
+	k_work_reschedule(&state->idle_work,
+			  K_MSEC(CONFIG_CONN_PROFILE_IDLE_TIMEOUT_MS));
+
+	if (state->profile != CONN_PROFILE_ACTIVE || state->pending) {
+		k_work_submit(&state->active_work);
+	}
+}
+
+void conn_profile_activity(struct bt_conn *conn)
+{
+	if (!conn) {
+		bt_conn_foreach(BT_CONN_TYPE_LE, activity, NULL);
+		return;
+	}
+
+	activity(conn, NULL);
+}
+
+static void connected(struct bt_conn *conn, uint8_t err)
+{
+	struct profile_state *state = &states[bt_conn_index(conn)];
+
+	if (err) {
+		return;
+	}
+
+	state->conn = bt_conn_ref(conn);
+	/* Whatever parameters the link came up with, discovery and the
+	 * first presses get the active profile.
+	 */
+	state->profile = CONN_PROFILE_IDLE;
+	state->pending = false;
+	k_work_init(&state->active_work, active_work_handler);
+	k_work_init_delayable(&state->idle_work, idle_work_handler);
+
+	activity(conn, NULL);
+}
+
+static void disconnected(struct bt_conn *conn, uint8_t reason)
+{
+	struct profile_state *state = &states[bt_conn_index(conn)];
+	struct k_work_sync sync;
+
+	if (!state->conn) {
+		return;
+	}
+
+	k_work_cancel_sync(&state->active_work, &sync);
+	k_work_cancel_delayable_sync(&state->idle_work, &sync);
+	bt_conn_unref(state->conn);
+	state->conn = NULL;
+}
+
+static void le_param_updated(struct bt_conn *conn, uint16_t interval,
+			     uint16_t latency, uint16_t timeout)
+{
+	/* Interval is in 1.25 ms units */
+	uint32_t interval_us = interval * 1250U;
+	/* A peripheral with latency only has to listen every latency + 1 events */
+	uint32_t wake_us = interval_us * (latency + 1U);
+	struct profile_state *state = &states[bt_conn_index(conn)];
+
+	if (state->conn) {
+		state->profile = profile_match(interval, latency);
+		state->pending = false;
+
+		/* Keys were used while the link was being made idle */
+		if (state->profile != CONN_PROFILE_ACTIVE &&
+		    k_work_delayable_is_pending(&state->idle_work)) {
+			k_work_submit(&state->active_work);
+		}
+	}
+
+	printk("[CONN PROFILE] interval %u.%02u ms, latency %u: "
+	       "%u central / %u peripheral radio events/s, "
+	       "press latency <= %u us\n",
+	       interval_us / 1000U, (interval_us % 1000U) / 10U, latency,
+	       USEC_PER_SEC / interval_us, USEC_PER_SEC / wake_us,
+	       interval_us);
+}
+
+BT_CONN_CB_DEFINE(conn_profile_callbacks) = {
+	.connected = connected,
+	.disconnected = disconnected,
+	.le_param_updated = le_param_updated,
+};
@@ -0,0 +1,34 @@
+/** @file
+ *  @brief Connection parameter profiles
+ */
+
+/*
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef CONN_PROFILE_H_
+#define CONN_PROFILE_H_
+
+#include <zephyr/bluetooth/conn.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+enum conn_profile {
+	/* 7.5 ms interval, no peripheral latency */
+	CONN_PROFILE_ACTIVE,
+	/* Long interval with peripheral latency */
+	CONN_PROFILE_IDLE,
+};
+
+/* Keys are in use on conn, or on every connection when conn is NULL.
+ * Moves the link to the active profile and restarts its idle timeout.
+ */
+void conn_profile_activity(struct bt_conn *conn);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* CONN_PROFILE_H_ */
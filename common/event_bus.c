@@ -0,0 +1,267 @@
+/** @file
+ *  @brief Event bus between inputs and outputs
+ *
+ *  Events are reference counted blocks of a memory slab. Publishing takes
+ *  one reference per subscriber and puts the event's address in each
+ *  subscriber's queue, so the payload is written once however many
+ *  subscribers read it. A subscriber whose queue is full misses the event
+ *  and counts it; nothing on the bus ever blocks.
+ */
+
+/*
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <zephyr/types.h>
+#include <stddef.h>
+#include <string.h>
+#include <zephyr/zephyr.h>
+#include <zephyr/sys/printk.h>
+
+#include "event_bus.h"
+
+K_MEM_SLAB_DEFINE_STATIC(event_slab, sizeof(struct event),
+			 CONFIG_EVENT_BUS_EVENTS, sizeof(void *));
+
+static sys_slist_t subs = SYS_SLIST_STATIC_INIT(&subs);
+static struct k_spinlock lock;
+static atomic_t pool_dropped;
+
+void event_bus_subscribe(struct event_sub *sub)
+{
+	k_spinlock_key_t key = k_spin_lock(&lock);
+
+	sys_slist_append(&subs, &sub->node);
+	k_spin_unlock(&lock, key);
+}
+
+void event_bus_unsubscribe(struct event_sub *sub)
+{
+	k_spinlock_key_t key = k_spin_lock(&lock);
+	struct event *ev;
+
+	sys_slist_find_and_remove(&subs, &sub->node);
+	k_spin_unlock(&lock, key);
+
+	while (!k_msgq_get(sub->queue, &ev, K_NO_WAIT)) {
+		event_bus_release(ev);
+	}
+}
+
+struct event *event_bus_alloc(enum event_chan chan)
+{
+	struct event *ev;
+
+	if (k_mem_slab_alloc(&event_slab, (void **)&ev, K_NO_WAIT)) {
+		atomic_inc(&pool_dropped);
+		return NULL;
+	}
+
+	(void)memset(ev, 0, sizeof(*ev));
+	ev->chan = chan;
+	/* The publisher's reference, dropped at the end of publishing */
+	atomic_set(&ev->refs, 1);
+	ev->stamp = k_cycle_get_32();
+
+	return ev;
+}
+
+/* The list is walked without the lock: writers only ever swap a single
+ * next pointer, and keeping interrupts enabled here lets a woken
+ * subscriber preempt a thread publisher right away.
+ */
+void event_bus_publish(struct event *ev)
+{
+	struct event_sub *sub;
+
+	SYS_SLIST_FOR_EACH_CONTAINER(&subs, sub, node) {
+		if (!(sub->channels & BIT(ev->chan))) {
+			continue;
+		}
+
+		atomic_inc(&ev->refs);
+		if (k_msgq_put(sub->queue, &ev, K_NO_WAIT)) {
+			atomic_dec(&ev->refs);
+			sub->dropped++;
+			continue;
+		}
+
+		if (sub->work) {
+			k_work_schedule(sub->work, K_NO_WAIT);
+		}
+	}
+
+	event_bus_release(ev);
+}
+
+const struct event *event_bus_get(struct event_sub *sub, k_timeout_t timeout)
+{
+	struct event *ev;
+
+	if (k_msgq_get(sub->queue, &ev, timeout)) {
+		return NULL;
+	}
+
+	return ev;
+}
+
+void event_bus_release(const struct event *ev)
+{
+	struct event *owned = (struct event *)ev;
+
+	if (atomic_dec(&owned->refs) == 1) {
+		k_mem_slab_free(&event_slab, (void **)&owned);
+	}
+}
+
+uint32_t event_bus_dropped(void)
+{
+	return atomic_get(&pool_dropped);
+}
+
+bool event_bus_publish_key(const struct key_event *key)
+{
+	struct event *ev = event_bus_alloc(EVENT_CHAN_KEY);
+
+	if (!ev) {
+		return false;
+	}
+
+	ev->key = *key;
+	event_bus_publish(ev);
+
+	return true;
+}
+
+bool event_bus_publish_conn(uint8_t index, bool connected, uint8_t reason)
+{
+	struct event *ev = event_bus_alloc(EVENT_CHAN_CONN);
+
+	if (!ev) {
+		return false;
+	}
+
+	ev->conn.index = index;
+	ev->conn.connected = connected;
+	ev->conn.reason = reason;
+	event_bus_publish(ev);
+
+	return true;
+}
+
+bool event_bus_publish_led(uint8_t led, enum led_op op)
+{
+	struct event *ev = event_bus_alloc(EVENT_CHAN_LED);
+
+	if (!ev) {
+		return false;
+	}
+
+	ev->led.led = led;
+	ev->led.op = op;
+	event_bus_publish(ev);
+
+	return true;
+}
+
+#if defined(CONFIG_EVENT_BUS_BENCH)
+#define BENCH_SUBS 8
+#define BENCH_EVENTS 200
+
+static struct event_sub bench_subs[BENCH_SUBS];
+static struct k_msgq bench_queues[BENCH_SUBS];
+static struct event *bench_bufs[BENCH_SUBS][4];
+static struct k_thread bench_threads[BENCH_SUBS];
+static K_THREAD_STACK_ARRAY_DEFINE(bench_stacks, BENCH_SUBS, 512);
+static K_SEM_DEFINE(bench_done, 0, BENCH_SUBS);
+
+static struct {
+	uint64_t cycles;
+	uint32_t max;
+	/* Latest delivery of the event in flight */
+	uint32_t last;
+} bench;
+
+static void bench_sub_thread(void *p1, void *p2, void *p3)
+{
+	struct event_sub *sub = p1;
+
+	while (1) {
+		const struct event *ev = event_bus_get(sub, K_FOREVER);
+		uint32_t cycles = k_cycle_get_32() - ev->stamp;
+		k_spinlock_key_t key = k_spin_lock(&lock);
+
+		bench.cycles += cycles;
+		bench.max = MAX(bench.max, cycles);
+		bench.last = MAX(bench.last, cycles);
+		k_spin_unlock(&lock, key);
+
+		event_bus_release(ev);
+		k_sem_give(&bench_done);
+	}
+}
+
+/* Publishes from a thread above the subscribers, as an ISR would, and
+ * waits for every delivery before the next event.
+ */
+static void bench_round(size_t count)
+{
+	uint64_t all_cycles = 0;
+
+	(void)memset(&bench, 0, sizeof(bench));
+
+	for (size_t i = 0; i < count; i++) {
+		event_bus_subscribe(&bench_subs[i]);
+	}
+
+	for (int n = 0; n < BENCH_EVENTS; n++) {
+		struct event *ev = event_bus_alloc(EVENT_CHAN_BENCH);
+
+		if (!ev) {
+			k_sleep(K_MSEC(1));
+			continue;
+		}
+
+		bench.last = 0;
+		event_bus_publish(ev);
+
+		for (size_t i = 0; i < count; i++) {
+			k_sem_take(&bench_done, K_FOREVER);
+		}
+		all_cycles += bench.last;
+	}
+
+	for (size_t i = 0; i < count; i++) {
+		event_bus_unsubscribe(&bench_subs[i]);
+	}
+
+	printk("[BUS] %zu subscribers: delivery avg %u us max %u us, "
+	       "last delivery avg %u us\n", count,
+	       k_cyc_to_us_floor32(bench.cycles / (count * BENCH_EVENTS)),
+	       k_cyc_to_us_floor32(bench.max),
+	       k_cyc_to_us_floor32(all_cycles / BENCH_EVENTS));
+}
+
+static void bench_thread(void)
+{
+	static const size_t rounds[] = { 1, 4, 8 };
+
+	for (size_t i = 0; i < BENCH_SUBS; i++) {
+		k_msgq_init(&bench_queues[i], (char *)bench_bufs[i],
+			    sizeof(struct event *), ARRAY_SIZE(bench_bufs[i]));
+		bench_subs[i].channels = BIT(EVENT_CHAN_BENCH);
+		bench_subs[i].queue = &bench_queues[i];
+		k_thread_create(&bench_threads[i], bench_stacks[i],
+				K_THREAD_STACK_SIZEOF(bench_stacks[i]),
+				bench_sub_thread, &bench_subs[i], NULL, NULL,
+				7, 0, K_NO_WAIT);
+	}
+
+	for (size_t i = 0; i < ARRAY_SIZE(rounds); i++) {
+		bench_round(rounds[i]);
+	}
+}
+
+K_THREAD_DEFINE(event_bench, 1024, bench_thread, NULL, NULL, NULL, 5, 0,
+		1000);
+#endif /* CONFIG_EVENT_BUS_BENCH */
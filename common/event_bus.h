@@ -0,0 +1,136 @@
+/** @file
+ *  @brief Event bus between inputs and outputs
+ *
+ *  Publishers fill an event from a shared pool and publish it once; every
+ *  subscriber to its channel gets a pointer to the same event through its
+ *  own message queue and releases it when done. The event returns to the
+ *  pool after the last release. Allocating and publishing are safe from
+ *  ISRs, subscribers run in threads or work items.
+ */
+
+/*
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef EVENT_BUS_H_
+#define EVENT_BUS_H_
+
+#include <zephyr/kernel.h>
+#include <zephyr/sys/slist.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+enum event_chan {
+	EVENT_CHAN_KEY,
+	EVENT_CHAN_CONN,
+	EVENT_CHAN_LED,
+	/* Only carried by the start-up benchmark */
+	EVENT_CHAN_BENCH,
+};
+
+/* key_event source of edges that came over no link */
+#define KEY_SOURCE_NONE 0xFF
+
+/* A key edge, local or heard from a peer */
+struct key_event {
+	/* Uptime in ticks when the edge was seen */
+	int64_t timestamp;
+	/* k_cycle_get_32() when the notification carrying the edge arrived,
+	 * 0 when it came over no link
+	 */
+	uint32_t rx_cycles;
+	uint16_t seq;
+	/* Link index, or KEY_SOURCE_NONE for local and broadcast keys */
+	uint8_t source;
+	uint8_t key;
+	bool down;
+};
+
+struct conn_event {
+	/* bt_conn_index() of the link */
+	uint8_t index;
+	bool connected;
+	/* HCI reason or error code */
+	uint8_t reason;
+};
+
+enum led_op {
+	LED_OP_OFF,
+	LED_OP_ON,
+	LED_OP_TOGGLE,
+};
+
+struct led_event {
+	/* led0, led1, ... devicetree alias */
+	uint8_t led;
+	enum led_op op;
+};
+
+struct event {
+	enum event_chan chan;
+	atomic_t refs;
+	/* k_cycle_get_32() at event_bus_alloc() */
+	uint32_t stamp;
+	union {
+		struct key_event key;
+		struct conn_event conn;
+		struct led_event led;
+	};
+};
+
+struct event_sub {
+	sys_snode_t node;
+	/* BIT() of every channel delivered */
+	uint32_t channels;
+	struct k_msgq *queue;
+	/* Scheduled without delay after each delivery when set; a run
+	 * already scheduled for later, such as a retry, keeps its time.
+	 */
+	struct k_work_delayable *work;
+	/* Events lost to a full queue */
+	uint32_t dropped;
+};
+
+/* Subscriber holding up to depth events; work may be NULL */
+#define EVENT_SUB_DEFINE(_name, _channels, _depth, _work)		\
+	K_MSGQ_DEFINE(_name##_queue, sizeof(struct event *), _depth,	\
+		      sizeof(void *));					\
+	static struct event_sub _name = {				\
+		.channels = (_channels),				\
+		.queue = &_name##_queue,				\
+		.work = (_work),					\
+	}
+
+void event_bus_subscribe(struct event_sub *sub);
+
+/* Stops delivery and releases the events still queued. Must not race
+ * with a publish on the subscriber's channels.
+ */
+void event_bus_unsubscribe(struct event_sub *sub);
+
+/* Event to fill in, or NULL when the pool is empty */
+struct event *event_bus_alloc(enum event_chan chan);
+
+/* Hands the event to every subscriber of its channel */
+void event_bus_publish(struct event *ev);
+
+/* Next event for sub, to be given back with event_bus_release() */
+const struct event *event_bus_get(struct event_sub *sub, k_timeout_t timeout);
+
+void event_bus_release(const struct event *ev);
+
+/* Events lost because the pool was empty */
+uint32_t event_bus_dropped(void);
+
+/* Allocate, fill and publish in one go; false if the pool was empty */
+bool event_bus_publish_key(const struct key_event *key);
+bool event_bus_publish_conn(uint8_t index, bool connected, uint8_t reason);
+bool event_bus_publish_led(uint8_t led, enum led_op op);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* EVENT_BUS_H_ */
@@ -0,0 +1,136 @@
+/** @file
+ *  @brief Fixed-point LED effects
+ *
+ *  Everything is 8-bit or Q8.8 integer math so frames render quickly on
+ *  cores without an FPU.
+ */
+
+/*
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <zephyr/types.h>
+#include <stddef.h>
+#include <zephyr/zephyr.h>
+#include <zephyr/drivers/led_strip.h>
+
+#include "led_engine.h"
+
+/* First quarter of a sine wave, 0..255 over 0..64 */
+static const uint8_t quarter_sine[65] = {
+	  0,   6,  13,  19,  25,  31,  37,  44,  50,  56,  62,  68,  74,
+	 80,  86,  92,  98, 103, 109, 115, 120, 126, 131, 136, 142, 147,
+	152, 157, 162, 167, 171, 176, 180, 185, 189, 193, 197, 201, 205,
+	208, 212, 215, 219, 222, 225, 228, 231, 233, 236, 238, 240, 242,
+	244, 246, 247, 249, 250, 251, 252, 253, 254, 254, 255, 255, 255,
+};
+
+/* Sine of theta (256 per turn), offset to 0..255 */
+static uint8_t sin8(uint8_t theta)
+{
+	uint8_t idx = theta & 0x3F;
+	uint8_t half;
+
+	if (theta & 0x40) {
+		idx = 64 - idx;
+	}
+
+	half = quarter_sine[idx] >> 1;
+
+	return (theta & 0x80) ? 128 - half : 128 + half;
+}
+
+static uint8_t scale8(uint8_t value, uint8_t scale)
+{
+	return ((uint16_t)value * (scale + 1U)) >> 8;
+}
+
+/* Full saturation hue (256 per turn) at brightness val */
+static void hue_to_rgb(uint8_t hue, uint8_t val, struct led_rgb *px)
+{
+	uint8_t sector = hue / 43U;
+	uint8_t rise = (hue - sector * 43U) * 6U;
+	uint8_t fall = 255U - rise;
+
+	switch (sector) {
+	case 0:
+		px->r = val; px->g = scale8(rise, val); px->b = 0;
+		break;
+	case 1:
+		px->r = scale8(fall, val); px->g = val; px->b = 0;
+		break;
+	case 2:
+		px->r = 0; px->g = val; px->b = scale8(rise, val);
+		break;
+	case 3:
+		px->r = 0; px->g = scale8(fall, val); px->b = val;
+		break;
+	case 4:
+		px->r = scale8(rise, val); px->g = 0; px->b = val;
+		break;
+	default:
+		px->r = val; px->g = 0; px->b = scale8(fall, val);
+		break;
+	}
+}
+
+static void render_rainbow(struct led_rgb *frame, size_t count, uint32_t t_ms)
+{
+	/* One full hue turn along the strip, in Q8.8 */
+	uint32_t step = (256U << 8) / count;
+	uint32_t hue = (t_ms / 8U) << 8;
+
+	for (size_t i = 0; i < count; i++, hue += step) {
+		hue_to_rgb(hue >> 8, 128, &frame[i]);
+	}
+}
+
+static void render_breathe(struct led_rgb *frame, size_t count, uint32_t t_ms)
+{
+	/* About one breath every two seconds */
+	uint8_t val = sin8(t_ms / 8U);
+	struct led_rgb px = {
+		.r = scale8(255, val),
+		.g = scale8(96, val),
+		.b = scale8(16, val),
+	};
+
+	for (size_t i = 0; i < count; i++) {
+		frame[i] = px;
+	}
+}
+
+static void render_comet(struct led_rgb *frame, size_t count, uint32_t t_ms)
+{
+	/* Head moves 60 pixels per second and leaves a fading tail */
+	size_t head = (t_ms * 60U / MSEC_PER_SEC) % count;
+	uint8_t hue = t_ms / 32U;
+
+	for (size_t i = 0; i < count; i++) {
+		size_t dist = (head + count - i) % count;
+		uint8_t val = dist < 16 ? 255U - dist * 16U : 0;
+
+		hue_to_rgb(hue, val, &frame[i]);
+	}
+}
+
+void led_effect_render(enum led_effect effect, struct led_rgb *frame,
+		       size_t count, uint32_t t_ms)
+{
+	if (!count) {
+		return;
+	}
+
+	switch (effect) {
+	case LED_EFFECT_RAINBOW:
+		render_rainbow(frame, count, t_ms);
+		break;
+	case LED_EFFECT_BREATHE:
+		render_breathe(frame, count, t_ms);
+		break;
+	case LED_EFFECT_COMET:
+	default:
+		render_comet(frame, count, t_ms);
+		break;
+	}
+}
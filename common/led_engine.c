@@ -0,0 +1,206 @@
+/** @file
+ *  @brief Addressable LED strip animation engine
+ *
+ *  Frames are rendered into one of two buffers while the other one is
+ *  being shifted out by the strip driver. The render thread is paced by
+ *  a timer; the push thread spends most of its time blocked on the SPI
+ *  transfer, so rendering the next frame overlaps with sending the
+ *  current one.
+ */
+
+/*
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <zephyr/types.h>
+#include <stddef.h>
+#include <string.h>
+#include <zephyr/sys/printk.h>
+#include <zephyr/sys/util.h>
+#include <zephyr/zephyr.h>
+#include <zephyr/drivers/led_strip.h>
+
+#include "led_engine.h"
+
+#define STATS_FRAMES (5 * MSEC_PER_SEC / CONFIG_LED_ENGINE_FRAME_MS)
+
+static struct led_rgb frames[2][CONFIG_LED_ENGINE_MAX_PIXELS];
+static uint8_t back;
+
+static const struct device *strip;
+static size_t pixels;
+static atomic_t effect = ATOMIC_INIT(LED_EFFECT_RAINBOW);
+static uint32_t (*clock_ms)(void) = k_uptime_get_32;
+
+/* Frame handed in through led_engine_show(), shown instead of effects */
+static struct led_rgb external[CONFIG_LED_ENGINE_MAX_PIXELS];
+static struct k_spinlock external_lock;
+static bool external_active;
+
+/* push_ready: a rendered frame is waiting, push_idle: the driver is free */
+static K_SEM_DEFINE(push_ready, 0, 1);
+static K_SEM_DEFINE(push_idle, 1, 1);
+static K_TIMER_DEFINE(frame_timer, NULL, NULL);
+
+/* Only the render thread touches these */
+static struct {
+	uint32_t frames;
+	uint32_t late;
+	uint32_t render_cyc;
+	uint32_t render_max_cyc;
+} stats;
+
+/* Updated by the push thread, read and cleared by the render thread */
+static struct {
+	uint32_t failed;
+	uint32_t push_cyc;
+} push_stats;
+static struct k_spinlock push_stats_lock;
+
+static void stats_print(void)
+{
+	k_spinlock_key_t key = k_spin_lock(&push_stats_lock);
+	uint32_t push_cyc = push_stats.push_cyc;
+	uint32_t failed = push_stats.failed;
+
+	memset(&push_stats, 0, sizeof(push_stats));
+	k_spin_unlock(&push_stats_lock, key);
+
+	printk("[LED] %u frames, render avg %u us max %u us, push avg %u us, "
+	       "%u late, %u failed\n",
+	       stats.frames,
+	       k_cyc_to_us_floor32(stats.render_cyc / stats.frames),
+	       k_cyc_to_us_floor32(stats.render_max_cyc),
+	       k_cyc_to_us_floor32(push_cyc / stats.frames),
+	       stats.late, failed);
+	memset(&stats, 0, sizeof(stats));
+}
+
+static void push_thread(void *p1, void *p2, void *p3)
+{
+	while (1) {
+		k_spinlock_key_t key;
+		uint32_t start, cyc;
+		int err;
+
+		k_sem_take(&push_ready, K_FOREVER);
+
+		start = k_cycle_get_32();
+		err = led_strip_update_rgb(strip, frames[!back], pixels);
+		cyc = k_cycle_get_32() - start;
+
+		key = k_spin_lock(&push_stats_lock);
+		push_stats.push_cyc += cyc;
+		if (err) {
+			push_stats.failed++;
+		}
+		k_spin_unlock(&push_stats_lock, key);
+
+		k_sem_give(&push_idle);
+	}
+}
+
+static bool render_external(struct led_rgb *frame)
+{
+	k_spinlock_key_t key = k_spin_lock(&external_lock);
+	bool active = external_active;
+
+	if (active) {
+		memcpy(frame, external, pixels * sizeof(external[0]));
+	}
+
+	k_spin_unlock(&external_lock, key);
+
+	return active;
+}
+
+static void render_thread(void *p1, void *p2, void *p3)
+{
+	k_timer_start(&frame_timer, K_NO_WAIT,
+		      K_MSEC(CONFIG_LED_ENGINE_FRAME_MS));
+
+	while (1) {
+		uint32_t start, cyc;
+
+		/* A status above one means we missed frame ticks */
+		if (k_timer_status_sync(&frame_timer) > 1) {
+			stats.late++;
+		}
+
+		start = k_cycle_get_32();
+		if (!render_external(frames[back])) {
+			led_effect_render(atomic_get(&effect), frames[back],
+					  pixels, clock_ms());
+		}
+		cyc = k_cycle_get_32() - start;
+		stats.render_cyc += cyc;
+		stats.render_max_cyc = MAX(stats.render_max_cyc, cyc);
+
+		/* Only swap once the previous frame has left the buffer */
+		if (k_sem_take(&push_idle, K_NO_WAIT)) {
+			stats.late++;
+			k_sem_take(&push_idle, K_FOREVER);
+		}
+		back = !back;
+		k_sem_give(&push_ready);
+
+		if (++stats.frames == STATS_FRAMES) {
+			stats_print();
+		}
+	}
+}
+
+K_THREAD_DEFINE(led_push, 1024, push_thread, NULL, NULL, NULL, 6, 0,
+		SYS_FOREVER_MS);
+K_THREAD_DEFINE(led_render, 1024, render_thread, NULL, NULL, NULL, 7, 0,
+		SYS_FOREVER_MS);
+
+void led_engine_set_effect(enum led_effect new_effect)
+{
+	k_spinlock_key_t key = k_spin_lock(&external_lock);
+
+	external_active = false;
+	atomic_set(&effect, new_effect % LED_EFFECT_COUNT);
+
+	k_spin_unlock(&external_lock, key);
+}
+
+void led_engine_set_clock(uint32_t (*now_ms)(void))
+{
+	clock_ms = now_ms;
+}
+
+void led_engine_show(const struct led_rgb *frame, size_t count)
+{
+	k_spinlock_key_t key = k_spin_lock(&external_lock);
+
+	count = MIN(count, ARRAY_SIZE(external));
+	memcpy(external, frame, count * sizeof(external[0]));
+	memset(&external[count], 0,
+	       (ARRAY_SIZE(external) - count) * sizeof(external[0]));
+	external_active = true;
+
+	k_spin_unlock(&external_lock, key);
+}
+
+int led_engine_start(const struct device *dev, size_t count)
+{
+	if (!device_is_ready(dev)) {
+		return -ENODEV;
+	}
+
+	if (strip) {
+		return -EALREADY;
+	}
+
+	strip = dev;
+	pixels = MIN(count, CONFIG_LED_ENGINE_MAX_PIXELS);
+
+	printk("[LED] %zu pixels, %u ms frames\n", pixels,
+	       CONFIG_LED_ENGINE_FRAME_MS);
+
+	k_thread_start(led_push);
+	k_thread_start(led_render);
+
+	return 0;
+}
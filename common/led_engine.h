@@ -0,0 +1,48 @@
+/** @file
+ *  @brief Addressable LED strip animation engine
+ */
+
+/*
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef LED_ENGINE_H_
+#define LED_ENGINE_H_
+
+#include <zephyr/device.h>
+#include <zephyr/drivers/led_strip.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+enum led_effect {
+	LED_EFFECT_RAINBOW,
+	LED_EFFECT_BREATHE,
+	LED_EFFECT_COMET,
+	LED_EFFECT_COUNT,
+};
+
+/* Render one frame of an effect at time t_ms. Integer math only. */
+void led_effect_render(enum led_effect effect, struct led_rgb *frame,
+		       size_t count, uint32_t t_ms);
+
+/* Start rendering and pushing frames to the first count pixels of strip */
+int led_engine_start(const struct device *strip, size_t count);
+void led_engine_set_effect(enum led_effect effect);
+
+/* Time source for effects, k_uptime_get_32 by default. Nodes sharing a
+ * clock here render the same effect in phase.
+ */
+void led_engine_set_clock(uint32_t (*now_ms)(void));
+
+/* Display frame instead of an effect until the next led_engine_set_effect.
+ * The pixels are copied, so frame may be reused right away.
+ */
+void led_engine_show(const struct led_rgb *frame, size_t count);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* LED_ENGINE_H_ */
@@ -0,0 +1,99 @@
+/** @file
+ *  @brief LED frame upload protocol
+ */
+
+/*
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <zephyr/types.h>
+#include <stddef.h>
+#include <errno.h>
+#include <zephyr/sys/byteorder.h>
+#include <zephyr/sys/util.h>
+
+#include "led_frame.h"
+
+static bool pixel_equal(const struct led_rgb *a, const struct led_rgb *b)
+{
+	return a->r == b->r && a->g == b->g && a->b == b->b;
+}
+
+size_t led_frame_encode(struct led_rgb *prev, const struct led_rgb *cur,
+			size_t count, size_t *cursor, uint8_t *buf,
+			size_t size)
+{
+	size_t i = *cursor;
+	size_t used = 0;
+
+	while (i < count) {
+		size_t start, pos;
+		uint8_t n = 0;
+
+		if (pixel_equal(&prev[i], &cur[i])) {
+			i++;
+			continue;
+		}
+
+		if (size - used < LED_FRAME_RUN_SIZE + LED_FRAME_PIXEL_SIZE) {
+			break;
+		}
+
+		/* An unchanged pixel costs as much as a new run header, so
+		 * runs simply stop at the first one.
+		 */
+		start = i;
+		pos = used + LED_FRAME_RUN_SIZE;
+		while (i < count && n < UINT8_MAX &&
+		       size - pos >= LED_FRAME_PIXEL_SIZE &&
+		       !pixel_equal(&prev[i], &cur[i])) {
+			buf[pos++] = cur[i].r;
+			buf[pos++] = cur[i].g;
+			buf[pos++] = cur[i].b;
+			prev[i] = cur[i];
+			i++;
+			n++;
+		}
+
+		sys_put_le16(start, &buf[used]);
+		buf[used + 2] = n;
+		used = pos;
+	}
+
+	*cursor = i;
+
+	return used;
+}
+
+int led_frame_decode(struct led_rgb *frame, size_t count,
+		     const uint8_t *buf, size_t len)
+{
+	while (len) {
+		uint16_t start;
+		uint8_t n;
+
+		if (len < LED_FRAME_RUN_SIZE) {
+			return -EINVAL;
+		}
+
+		start = sys_get_le16(buf);
+		n = buf[2];
+		buf += LED_FRAME_RUN_SIZE;
+		len -= LED_FRAME_RUN_SIZE;
+
+		if (len < n * LED_FRAME_PIXEL_SIZE || start + n > count) {
+			return -EINVAL;
+		}
+
+		for (uint8_t i = 0; i < n; i++) {
+			frame[start + i].r = buf[0];
+			frame[start + i].g = buf[1];
+			frame[start + i].b = buf[2];
+			buf += LED_FRAME_PIXEL_SIZE;
+		}
+
+		len -= n * LED_FRAME_PIXEL_SIZE;
+	}
+
+	return 0;
+}
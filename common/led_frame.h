@@ -0,0 +1,60 @@
+/** @file
+ *  @brief LED frame upload protocol
+ *
+ *  Frames travel over an L2CAP connection-oriented channel as SDUs of
+ *  the form:
+ *
+ *    uint16_t frame   frame number, little endian
+ *    uint8_t  flags   LED_FRAME_RESET, LED_FRAME_END
+ *    runs...          { uint16_t start; uint8_t count; rgb[count] }
+ *
+ *  Runs only carry pixels that differ from the previous frame. A frame
+ *  larger than one SDU is split across several, the last one carrying
+ *  LED_FRAME_END.
+ */
+
+/*
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef LED_FRAME_H_
+#define LED_FRAME_H_
+
+#include <zephyr/types.h>
+#include <stddef.h>
+#include <zephyr/drivers/led_strip.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Dynamic LE PSM the peripheral listens on */
+#define LED_FRAME_PSM 0x0081
+
+#define LED_FRAME_HEADER_SIZE 3
+#define LED_FRAME_RUN_SIZE 3
+#define LED_FRAME_PIXEL_SIZE 3
+
+/* Receiver clears its copy of the frame before applying the runs */
+#define LED_FRAME_RESET BIT(0)
+/* Last SDU of a frame, the receiver can display it */
+#define LED_FRAME_END BIT(1)
+
+/* Encode pixels of cur that differ from prev, starting at *cursor, into
+ * at most size bytes of buf. prev is updated for every pixel written and
+ * *cursor advances past them; it equals count once the frame is done.
+ * Returns the number of bytes written.
+ */
+size_t led_frame_encode(struct led_rgb *prev, const struct led_rgb *cur,
+			size_t count, size_t *cursor, uint8_t *buf,
+			size_t size);
+
+/* Apply the runs of one SDU, header already stripped, to frame */
+int led_frame_decode(struct led_rgb *frame, size_t count,
+		     const uint8_t *buf, size_t len);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* LED_FRAME_H_ */
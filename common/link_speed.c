@@ -0,0 +1,163 @@
+/** @file
+ *  @brief 2M PHY, data length and ATT MTU negotiation
+ *
+ *  Self-contained: the module hooks the connection callbacks itself. On
+ *  links where this device is central it requests 2M PHY, the maximum
+ *  LL data length and, with a GATT client, a larger ATT MTU. A peer
+ *  that refuses simply leaves the link on 1M and 27 byte PDUs. Both
+ *  roles log the outcome with the resulting PDU air time.
+ */
+
+/*
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <zephyr/types.h>
+#include <stddef.h>
+#include <errno.h>
+#include <zephyr/zephyr.h>
+#include <zephyr/sys/printk.h>
+
+#include <zephyr/bluetooth/bluetooth.h>
+#include <zephyr/bluetooth/conn.h>
+#include <zephyr/bluetooth/gatt.h>
+
+struct link_state {
+	struct bt_conn *conn;
+	struct k_work work;
+	struct bt_gatt_exchange_params mtu_params;
+	uint8_t tx_phy;
+	uint16_t tx_max_len;
+};
+
+static struct link_state states[CONFIG_BT_MAX_CONN];
+
+/* Air time of one LL data PDU carrying payload_len bytes */
+static uint32_t pdu_air_us(uint8_t phy, uint16_t payload_len)
+{
+	/* Access address, header, payload, MIC (links are encrypted) and CRC */
+	uint32_t bytes = 4 + 2 + payload_len + 4 + 3;
+
+	if (phy == BT_GAP_LE_PHY_2M) {
+		/* Two byte preamble, 2 Mbit/s */
+		return (bytes + 2) * 8 / 2;
+	}
+
+	/* One byte preamble, 1 Mbit/s */
+	return (bytes + 1) * 8;
+}
+
+static void log_link(const struct link_state *state)
+{
+	uint32_t air_us = pdu_air_us(state->tx_phy, state->tx_max_len);
+
+	printk("[LINK] TX %uM PHY, %u byte PDUs: %u us on air each, "
+	       "%u kbit/s raw payload rate\n",
+	       state->tx_phy == BT_GAP_LE_PHY_2M ? 2 : 1, state->tx_max_len,
+	       air_us, state->tx_max_len * 8U * 1000U / air_us);
+}
+
+#if defined(CONFIG_BT_GATT_CLIENT)
+static void mtu_exchanged(struct bt_conn *conn, uint8_t err,
+			  struct bt_gatt_exchange_params *params)
+{
+	if (err) {
+		printk("[LINK] MTU exchange refused (err 0x%02x), staying at %u\n",
+		       err, bt_gatt_get_mtu(conn));
+		return;
+	}
+
+	printk("[LINK] ATT MTU %u\n", bt_gatt_get_mtu(conn));
+}
+#endif /* CONFIG_BT_GATT_CLIENT */
+
+/* PHY and data length requests wait for the controller, so they run
+ * here rather than in the connected callback.
+ */
+static void link_work_handler(struct k_work *work)
+{
+	struct link_state *state = CONTAINER_OF(work, struct link_state, work);
+	int err;
+
+	err = bt_conn_le_phy_update(state->conn, BT_CONN_LE_PHY_PARAM_2M);
+	if (err) {
+		printk("[LINK] 2M PHY request failed (err %d), keeping 1M\n", err);
+	}
+
+	err = bt_conn_le_data_len_update(state->conn, BT_LE_DATA_LEN_PARAM_MAX);
+	if (err) {
+		printk("[LINK] Data length request failed (err %d)\n", err);
+	}
+
+#if defined(CONFIG_BT_GATT_CLIENT)
+	state->mtu_params.func = mtu_exchanged;
+	err = bt_gatt_exchange_mtu(state->conn, &state->mtu_params);
+	if (err && err != -EALREADY) {
+		printk("[LINK] MTU exchange failed (err %d)\n", err);
+	}
+#endif
+}
+
+static void connected(struct bt_conn *conn, uint8_t err)
+{
+	struct link_state *state = &states[bt_conn_index(conn)];
+	struct bt_conn_info info;
+
+	if (err || bt_conn_get_info(conn, &info)) {
+		return;
+	}
+
+	state->conn = bt_conn_ref(conn);
+	state->tx_phy = BT_GAP_LE_PHY_1M;
+	state->tx_max_len = 27;
+	k_work_init(&state->work, link_work_handler);
+
+	/* The peripheral side only follows what the central negotiates */
+	if (info.role == BT_CONN_ROLE_CENTRAL) {
+		k_work_submit(&state->work);
+	}
+}
+
+static void disconnected(struct bt_conn *conn, uint8_t reason)
+{
+	struct link_state *state = &states[bt_conn_index(conn)];
+	struct k_work_sync sync;
+
+	if (!state->conn) {
+		return;
+	}
+
+	k_work_cancel_sync(&state->work, &sync);
+	bt_conn_unref(state->conn);
+	state->conn = NULL;
+}
+
+static void le_phy_updated(struct bt_conn *conn,
+			   struct bt_conn_le_phy_info *param)
+{
+	struct link_state *state = &states[bt_conn_index(conn)];
+
+	if (param->tx_phy != BT_GAP_LE_PHY_2M) {
+		printk("[LINK] Peer kept the %s PHY\n",
+		       param->tx_phy == BT_GAP_LE_PHY_CODED ? "coded" : "1M");
+	}
+
+	state->tx_phy = param->tx_phy;
+	log_link(state);
+}
+
+static void le_data_len_updated(struct bt_conn *conn,
+				struct bt_conn_le_data_len_info *info)
+{
+	struct link_state *state = &states[bt_conn_index(conn)];
+
+	state->tx_max_len = info->tx_max_len;
+	log_link(state);
+}
+
+BT_CONN_CB_DEFINE(link_speed_callbacks) = {
+	.connected = connected,
+	.disconnected = disconnected,
+	.le_phy_updated = le_phy_updated,
+	.le_data_len_updated = le_data_len_updated,
+};
@@ -0,0 +1,129 @@
+/** @file
+ *  @brief Keypress records carried by the PRESS characteristic
+ *
+ *  A PRESS notification starts with the peripheral's clock, in
+ *  microseconds, at the first record's edge, and the id of the
+ *  peripheral the keys belong to:
+ *
+ *    uint32_t base_us
+ *    uint32_t origin     press_origin() of the peripheral's identity
+ *                        address, the same for every observer even
+ *                        when it advertises with a private address
+ *
+ *  followed by a run of fixed-size records, as many as fit in the ATT
+ *  MTU. Each record is, little endian:
+ *
+ *    uint16_t seq        increments once per debounced edge, including
+ *                        edges the peripheral had to drop
+ *    uint8_t  key_edge   key id in bits 0-6, bit 7 set on a press
+ *    uint16_t delta_ms   time since the previous edge, saturating
+ *
+ *  The CLOCK characteristic reads back the same microsecond clock so a
+ *  central can estimate the offset between the two devices.
+ *
+ *  Relay nodes forward the presses they hear on the RELAY characteristic
+ *  instead. Its notifications start with the relay's clock when the
+ *  notification was built (uint32_t, microseconds), followed by records
+ *  of:
+ *
+ *    uint32_t origin     origin from the peripheral's PRESS header
+ *    uint16_t seq        that peripheral's PRESS sequence number
+ *    uint8_t  key_edge   as above
+ *    uint8_t  ttl        hops the record may still take
+ */
+
+/*
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef PRESS_RECORD_H_
+#define PRESS_RECORD_H_
+
+#include <zephyr/types.h>
+#include <zephyr/kernel.h>
+#include <zephyr/sys/byteorder.h>
+#include <zephyr/bluetooth/addr.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define PRESS_HEADER_SIZE 8
+#define PRESS_RELAY_HEADER_SIZE 4
+#define PRESS_RECORD_SIZE 5
+#define PRESS_RECORD_EDGE_DOWN BIT(7)
+#define PRESS_RECORD_KEY_MASK 0x7F
+#define PRESS_RELAY_RECORD_SIZE 8
+
+struct press_record {
+	uint16_t seq;
+	uint8_t key;
+	bool down;
+	uint16_t delta_ms;
+};
+
+struct press_relay_record {
+	uint32_t origin;
+	uint16_t seq;
+	uint8_t key;
+	bool down;
+	uint8_t ttl;
+};
+
+/* Microsecond clock shared by the PRESS header and CLOCK characteristic */
+static inline uint32_t press_clock_us(int64_t ticks)
+{
+	return (uint32_t)k_ticks_to_us_floor64(ticks);
+}
+
+/* Origin id of a peripheral from its identity address */
+static inline uint32_t press_origin(const bt_addr_le_t *addr)
+{
+	/* Fold the 48-bit address; the type only matters for collisions */
+	return sys_get_le32(&addr->a.val[0]) ^
+	       ((uint32_t)sys_get_le16(&addr->a.val[4]) << 16) ^ addr->type;
+}
+
+static inline void press_record_encode(const struct press_record *rec,
+				       uint8_t *buf)
+{
+	sys_put_le16(rec->seq, &buf[0]);
+	buf[2] = (rec->key & PRESS_RECORD_KEY_MASK) |
+		 (rec->down ? PRESS_RECORD_EDGE_DOWN : 0);
+	sys_put_le16(rec->delta_ms, &buf[3]);
+}
+
+static inline void press_record_decode(const uint8_t *buf,
+				       struct press_record *rec)
+{
+	rec->seq = sys_get_le16(&buf[0]);
+	rec->key = buf[2] & PRESS_RECORD_KEY_MASK;
+	rec->down = (buf[2] & PRESS_RECORD_EDGE_DOWN) != 0;
+	rec->delta_ms = sys_get_le16(&buf[3]);
+}
+
+static inline void press_relay_record_encode(const struct press_relay_record *rec,
+					     uint8_t *buf)
+{
+	sys_put_le32(rec->origin, &buf[0]);
+	sys_put_le16(rec->seq, &buf[4]);
+	buf[6] = (rec->key & PRESS_RECORD_KEY_MASK) |
+		 (rec->down ? PRESS_RECORD_EDGE_DOWN : 0);
+	buf[7] = rec->ttl;
+}
+
+static inline void press_relay_record_decode(const uint8_t *buf,
+					     struct press_relay_record *rec)
+{
+	rec->origin = sys_get_le32(&buf[0]);
+	rec->seq = sys_get_le16(&buf[4]);
+	rec->key = buf[6] & PRESS_RECORD_KEY_MASK;
+	rec->down = (buf[6] & PRESS_RECORD_EDGE_DOWN) != 0;
+	rec->ttl = buf[7];
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* PRESS_RECORD_H_ */
@@ -0,0 +1,44 @@
+/** @file
+ *  @brief Shared timebase messages written to the SYNC characteristic
+ *
+ *  The central's microsecond uptime is the shared timebase. It keeps
+ *  estimating each peripheral's clock from CLOCK reads and writes the
+ *  good samples back, little endian, so the peripheral can discipline
+ *  its own copy of the shared clock:
+ *
+ *    uint8_t  op        TIME_SYNC_OP_SAMPLE
+ *    uint32_t peer_us   peripheral CLOCK value the sample was taken at
+ *    uint64_t shared_us central time at the same instant
+ *
+ *  Actions carry the shared instant at which every node applies them:
+ *
+ *    uint8_t  op        TIME_SYNC_OP_EFFECT
+ *    uint64_t at_us     shared time to switch at
+ *    uint8_t  effect    enum led_effect
+ */
+
+/*
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef TIME_SYNC_H_
+#define TIME_SYNC_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define BT_UUID_CUSTOM_SERVICE_SYNC \
+	BT_UUID_128_ENCODE(0x12345678, 0x1234, 0x5678, 0x1234, 0xCCCCCCCCCCCC)
+
+#define TIME_SYNC_OP_SAMPLE 0x00
+#define TIME_SYNC_OP_EFFECT 0x01
+
+#define TIME_SYNC_SAMPLE_SIZE 13
+#define TIME_SYNC_EFFECT_SIZE 10
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* TIME_SYNC_H_ */
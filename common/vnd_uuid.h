@@ -0,0 +1,40 @@
+/** @file
+ *  @brief Vendor UUIDs shared by the central, relay and peripheral
+ *
+ *  Every node advertises the KEY service and serves it over GATT:
+ *
+ *    peripheral   PRESS (notify) and CLOCK (read)
+ *    relay node   RELAY (notify) and CLOCK (read)
+ *
+ *  The payloads are described in press_record.h. SYNC, written by the
+ *  central, lives in time_sync.h.
+ */
+
+/*
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef VND_UUID_H_
+#define VND_UUID_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define BT_UUID_CUSTOM_SERVICE_KEY \
+	BT_UUID_128_ENCODE(0xDEADBEEF, 0xFEED, 0xBEEF, 0xF1D0, 0xFFFFFFFFFFFF)
+
+#define BT_UUID_CUSTOM_SERVICE_PRESS \
+	BT_UUID_128_ENCODE(0x12345678, 0x1234, 0x5678, 0x1234, 0xEEEEEEEEEEEE)
+
+#define BT_UUID_CUSTOM_SERVICE_CLOCK \
+	BT_UUID_128_ENCODE(0x12345678, 0x1234, 0x5678, 0x1234, 0xDDDDDDDDDDDD)
+
+#define BT_UUID_CUSTOM_SERVICE_RELAY \
+	BT_UUID_128_ENCODE(0x12345678, 0x1234, 0x5678, 0x1234, 0xBBBBBBBBBBBB)
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* VND_UUID_H_ */
@@ -0,0 +1,128 @@
+#!/usr/bin/env python3
+# SPDX-License-Identifier: Apache-2.0
+
+"""Decode the telemetry stream of the console sample.
+
+Frames are COBS encoded and end with a zero byte. Decoded, a frame is a
+record type byte, the payload and a little-endian CRC-16 (the reflected
+CCITT polynomial seeded with 0xFFFF, as Zephyr's crc16_ccitt()) over the
+type and payload.
+
+    decode.py /dev/ttyACM0      # needs pyserial
+    decode.py capture.bin
+    decode.py - < capture.bin
+"""
+
+import argparse
+import struct
+import sys
+import time
+
+TELEMETRY_STATS = 0
+TELEMETRY_SAMPLE = 1
+
+STATS = struct.Struct('<IIIIHH')
+
+
+def crc16_ccitt(seed, data):
+    for byte in data:
+        e = (seed ^ byte) & 0xFF
+        f = (e ^ (e << 4)) & 0xFF
+        seed = ((seed >> 8) ^ (f << 8) ^ (f << 3) ^ (f >> 4)) & 0xFFFF
+    return seed
+
+
+def cobs_decode(data):
+    out = bytearray()
+    pos = 0
+    while pos < len(data):
+        code = data[pos]
+        if code == 0 or pos + code > len(data):
+            return None
+        out += data[pos + 1:pos + code]
+        pos += code
+        if code < 0xFF and pos < len(data):
+            out.append(0)
+    return bytes(out)
+
+
+def frames(stream):
+    """Yields the bytes between delimiters, resynchronizing on each zero"""
+    buf = bytearray()
+    while True:
+        chunk = stream.read(4096)
+        if not chunk:
+            return
+        buf += chunk
+        while True:
+            end = buf.find(0)
+            if end < 0:
+                break
+            yield bytes(buf[:end])
+            del buf[:end + 1]
+
+
+def open_input(path):
+    if path == '-':
+        return sys.stdin.buffer
+    if path.startswith('/dev/') or path.upper().startswith('COM'):
+        import serial
+        return serial.Serial(path, timeout=1)
+    return open(path, 'rb')
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__,
+                                     formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument('input', help='serial port, capture file or -')
+    parser.add_argument('-v', '--verbose', action='store_true',
+                        help='print every SAMPLE record')
+    args = parser.parse_args()
+
+    bad = 0
+    samples = 0
+    lost = 0
+    next_seq = None
+    wire_bytes = 0
+    started = time.monotonic()
+
+    for raw in frames(open_input(args.input)):
+        wire_bytes += len(raw) + 1
+        if not raw:
+            continue
+
+        frame = cobs_decode(raw)
+        if frame is None or len(frame) < 3 or \
+           crc16_ccitt(0xFFFF, frame[:-2]) != struct.unpack('<H', frame[-2:])[0]:
+            # Text printed on a shared console lands here too
+            bad += 1
+            continue
+
+        rec_type, payload = frame[0], frame[1:-2]
+
+        if rec_type == TELEMETRY_SAMPLE and len(payload) >= 8:
+            seq, cycles = struct.unpack_from('<II', payload)
+            if next_seq is not None and seq != next_seq:
+                lost += (seq - next_seq) & 0xFFFFFFFF
+            next_seq = (seq + 1) & 0xFFFFFFFF
+            samples += 1
+            if args.verbose:
+                print(f'SAMPLE seq {seq} cycles {cycles}')
+        elif rec_type == TELEMETRY_STATS and len(payload) >= STATS.size:
+            (uptime_ms, frame_count, byte_count, dropped,
+             isr_permille, cpu_permille) = STATS.unpack_from(payload)
+            elapsed = max(time.monotonic() - started, 1e-3)
+            print(f'[{uptime_ms / 1000:.3f}] device: {frame_count} frames, '
+                  f'{byte_count} bytes, {dropped} dropped, '
+                  f'isr {isr_permille / 10:.1f}% cpu {cpu_permille / 10:.1f}% | '
+                  f'host: {wire_bytes / elapsed / 1000:.1f} kB/s, '
+                  f'{samples} samples, {lost} lost, {bad} bad frames')
+        else:
+            print(f'unknown record type {rec_type}, {len(payload)} bytes')
+
+
+if __name__ == '__main__':
+    try:
+        main()
+    except KeyboardInterrupt:
+        pass
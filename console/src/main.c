@@ -6,16 +6,68 @@
 
 #include <zephyr/zephyr.h>
 #include <zephyr/sys/printk.h>
+#include <zephyr/sys/byteorder.h>
 #include <zephyr/usb/usb_device.h>
 #include <zephyr/drivers/uart.h>
 
+#include "telemetry.h"
+
 BUILD_ASSERT(DT_NODE_HAS_COMPAT(DT_CHOSEN(zephyr_console), zephyr_cdc_acm_uart),
 	     "Console device is not ACM CDC UART device");
 
+/* Telemetry shares the console unless a second ACM instance is chosen */
+#if DT_HAS_CHOSEN(tree_telemetry)
+#define TELEMETRY_NODE DT_CHOSEN(tree_telemetry)
+#else
+#define TELEMETRY_NODE DT_CHOSEN(zephyr_console)
+#endif
+
+BUILD_ASSERT(CONFIG_CONSOLE_TELEMETRY_SAMPLE_SIZE >= 8 &&
+	     CONFIG_CONSOLE_TELEMETRY_SAMPLE_SIZE <=
+	     CONFIG_CONSOLE_TELEMETRY_MAX_PAYLOAD,
+	     "Sample records hold at least a sequence number and a cycle count");
+
+/* Stands in for the hub's producers. At CONFIG_CONSOLE_TELEMETRY_SAMPLE_HZ
+ * of 0 it claims records back to back and is only paced by the link, to
+ * measure sustained throughput.
+ */
+static void sample_thread(void)
+{
+	uint32_t seq = 0;
+
+	while (1) {
+		uint8_t *rec = telemetry_claim(TELEMETRY_SAMPLE,
+					       CONFIG_CONSOLE_TELEMETRY_SAMPLE_SIZE,
+					       K_FOREVER);
+
+		if (rec) {
+			sys_put_le32(seq, rec);
+			sys_put_le32(k_cycle_get_32(), rec + 4);
+			/* A counting pattern, zeros included, so the host can
+			 * check the COBS stuffing.
+			 */
+			for (size_t i = 8; i < CONFIG_CONSOLE_TELEMETRY_SAMPLE_SIZE; i++) {
+				rec[i] = seq + i;
+			}
+			telemetry_commit(rec);
+		}
+		seq++;
+
+		if (CONFIG_CONSOLE_TELEMETRY_SAMPLE_HZ) {
+			k_sleep(K_USEC(USEC_PER_SEC /
+				       CONFIG_CONSOLE_TELEMETRY_SAMPLE_HZ));
+		}
+	}
+}
+
+K_THREAD_DEFINE(telemetry_samples, 1024, sample_thread, NULL, NULL, NULL, 7, 0,
+		SYS_FOREVER_MS);
+
 void main(void)
 {
-	const struct device *dev = DEVICE_DT_GET(DT_CHOSEN(zephyr_console));
+	const struct device *telemetry_dev = DEVICE_DT_GET(TELEMETRY_NODE);
 	uint32_t dtr = 0;
+	int err;
 
 	if (usb_enable(NULL)) {
 		return;
@@ -23,13 +75,20 @@ void main(void)
 
 	/* Poll if the DTR flag was set */
 	while (!dtr) {
-		uart_line_ctrl_get(dev, UART_LINE_CTRL_DTR, &dtr);
+		uart_line_ctrl_get(telemetry_dev, UART_LINE_CTRL_DTR, &dtr);
 		/* Give CPU resources to low priority threads. */
 		k_sleep(K_MSEC(100));
 	}
 
-	while (1) {
-		printk("Hello World! %s\n", CONFIG_ARCH);
-		k_sleep(K_SECONDS(1));
+	printk("Telemetry on %s, %d byte samples\n", telemetry_dev->name,
+	       CONFIG_CONSOLE_TELEMETRY_SAMPLE_SIZE);
+
+	err = telemetry_start(telemetry_dev);
+	if (err) {
+		printk("Telemetry failed to start (err %d)\n", err);
+		return;
 	}
+
+	/* From here on the stream owns the link; stay quiet on a shared one */
+	k_thread_start(telemetry_samples);
 }
@@ -0,0 +1,378 @@
+/** @file
+ *  @brief Framed binary telemetry over an interrupt driven UART
+ *
+ *  Producers reserve a record straight in the ring buffer, fill it in
+ *  place and commit it, so the payload is never copied before framing.
+ *  Records never wrap: one that does not fit before the end of the ring
+ *  leaves a skip marker there and starts over at the front. The TX
+ *  interrupt frames the oldest committed record into a staging buffer,
+ *  releases its ring space right away and feeds the staging buffer to
+ *  the UART FIFO.
+ */
+
+/*
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <zephyr/types.h>
+#include <stddef.h>
+#include <errno.h>
+#include <zephyr/zephyr.h>
+#include <zephyr/drivers/uart.h>
+#include <zephyr/sys/byteorder.h>
+#include <zephyr/sys/crc.h>
+
+#include "telemetry.h"
+
+#define RING_SIZE CONFIG_CONSOLE_TELEMETRY_RING_SIZE
+
+/* Type byte, payload and CRC before COBS; the encoding adds one byte
+ * per 254 plus the leading code byte, then the zero delimiter.
+ */
+#define FRAME_RAW_MAX (1 + CONFIG_CONSOLE_TELEMETRY_MAX_PAYLOAD + 2)
+#define FRAME_MAX (FRAME_RAW_MAX + FRAME_RAW_MAX / 254 + 2)
+
+BUILD_ASSERT(RING_SIZE % 4 == 0, "Ring size must be a multiple of 4");
+
+enum record_state {
+	RECORD_CLAIMED,
+	RECORD_COMMITTED,
+	/* Unused space up to the end of the ring */
+	RECORD_SKIP,
+};
+
+struct record_hdr {
+	uint16_t len;
+	uint8_t type;
+	uint8_t state;
+};
+
+static uint8_t __aligned(4) ring[RING_SIZE];
+static size_t ring_head;
+static size_t ring_tail;
+static size_t ring_used;
+static struct k_spinlock lock;
+static K_SEM_DEFINE(space_sem, 0, 1);
+
+static const struct device *tx_uart;
+static bool tx_busy;
+static uint8_t tx_buf[FRAME_MAX];
+static size_t tx_len;
+static size_t tx_pos;
+
+static struct {
+	uint32_t frames;
+	uint32_t bytes;
+	atomic_t dropped;
+	/* Wraps; only differences are used */
+	uint32_t isr_cycles;
+} stats;
+
+static size_t record_size(size_t len)
+{
+	return ROUND_UP(sizeof(struct record_hdr) + len, 4);
+}
+
+static struct record_hdr *ring_alloc(uint8_t type, size_t len)
+{
+	size_t need = record_size(len);
+	struct record_hdr *hdr;
+	size_t at;
+
+	if (ring_used == 0U) {
+		ring_head = 0;
+		ring_tail = 0;
+	} else if (ring_used == RING_SIZE) {
+		return NULL;
+	}
+
+	if (ring_head >= ring_tail) {
+		if (RING_SIZE - ring_head >= need) {
+			at = ring_head;
+		} else if (ring_tail >= need) {
+			hdr = (struct record_hdr *)&ring[ring_head];
+			hdr->state = RECORD_SKIP;
+			ring_used += RING_SIZE - ring_head;
+			at = 0;
+		} else {
+			return NULL;
+		}
+	} else if (ring_tail - ring_head >= need) {
+		at = ring_head;
+	} else {
+		return NULL;
+	}
+
+	ring_head = (at + need) % RING_SIZE;
+	ring_used += need;
+
+	/* Marked before the lock drops, the slot may hold a stale state */
+	hdr = (struct record_hdr *)&ring[at];
+	hdr->len = len;
+	hdr->type = type;
+	hdr->state = RECORD_CLAIMED;
+
+	return hdr;
+}
+
+/* Oldest record if it is ready to send, dropping skip markers on the way */
+static struct record_hdr *ring_peek(void)
+{
+	while (ring_used) {
+		struct record_hdr *hdr = (struct record_hdr *)&ring[ring_tail];
+
+		if (hdr->state != RECORD_SKIP) {
+			return hdr->state == RECORD_COMMITTED ? hdr : NULL;
+		}
+
+		ring_used -= RING_SIZE - ring_tail;
+		ring_tail = 0;
+	}
+
+	return NULL;
+}
+
+static void ring_release(struct record_hdr *hdr)
+{
+	size_t size = record_size(hdr->len);
+
+	ring_tail = (ring_tail + size) % RING_SIZE;
+	ring_used -= size;
+}
+
+struct cobs {
+	uint8_t *out;
+	size_t code_at;
+	size_t pos;
+	uint8_t code;
+};
+
+static void cobs_start(struct cobs *c, uint8_t *out)
+{
+	c->out = out;
+	c->code_at = 0;
+	c->pos = 1;
+	c->code = 1;
+}
+
+static void cobs_put(struct cobs *c, const uint8_t *data, size_t len)
+{
+	for (size_t i = 0; i < len; i++) {
+		if (data[i]) {
+			c->out[c->pos++] = data[i];
+			c->code++;
+		}
+
+		if (!data[i] || c->code == 0xFF) {
+			c->out[c->code_at] = c->code;
+			c->code_at = c->pos++;
+			c->code = 1;
+		}
+	}
+}
+
+/* Closes the last block and appends the delimiter; returns the length */
+static size_t cobs_end(struct cobs *c)
+{
+	c->out[c->code_at] = c->code;
+	c->out[c->pos++] = 0;
+
+	return c->pos;
+}
+
+static size_t frame_encode(const struct record_hdr *hdr, uint8_t *out)
+{
+	const uint8_t *payload = (const uint8_t *)(hdr + 1);
+	uint8_t crc[2];
+	struct cobs c;
+
+	sys_put_le16(crc16_ccitt(crc16_ccitt(0xFFFF, &hdr->type, 1),
+				 payload, hdr->len), crc);
+
+	cobs_start(&c, out);
+	cobs_put(&c, &hdr->type, 1);
+	cobs_put(&c, payload, hdr->len);
+	cobs_put(&c, crc, sizeof(crc));
+
+	return cobs_end(&c);
+}
+
+/* Frames the next record into tx_buf, or stops the TX interrupt when
+ * there is none. Only the TX interrupt consumes records, so the one at
+ * the tail can be encoded without holding the lock.
+ */
+static bool tx_load(void)
+{
+	k_spinlock_key_t key = k_spin_lock(&lock);
+	struct record_hdr *hdr = ring_peek();
+
+	if (!hdr) {
+		uart_irq_tx_disable(tx_uart);
+		tx_busy = false;
+		k_spin_unlock(&lock, key);
+		return false;
+	}
+	k_spin_unlock(&lock, key);
+
+	tx_len = frame_encode(hdr, tx_buf);
+	tx_pos = 0;
+	stats.frames++;
+
+	key = k_spin_lock(&lock);
+	ring_release(hdr);
+	k_spin_unlock(&lock, key);
+
+	k_sem_give(&space_sem);
+
+	return true;
+}
+
+static void uart_isr(const struct device *dev, void *user_data)
+{
+	uint32_t start = k_cycle_get_32();
+
+	while (uart_irq_update(dev) && uart_irq_tx_ready(dev)) {
+		int sent;
+
+		if (tx_pos == tx_len && !tx_load()) {
+			break;
+		}
+
+		sent = uart_fifo_fill(dev, &tx_buf[tx_pos], tx_len - tx_pos);
+		if (sent <= 0) {
+			break;
+		}
+
+		tx_pos += sent;
+		stats.bytes += sent;
+	}
+
+	stats.isr_cycles += k_cycle_get_32() - start;
+}
+
+void *telemetry_claim(enum telemetry_type type, size_t len,
+		      k_timeout_t timeout)
+{
+	struct record_hdr *hdr;
+
+	if (len > CONFIG_CONSOLE_TELEMETRY_MAX_PAYLOAD) {
+		atomic_inc(&stats.dropped);
+		return NULL;
+	}
+
+	for (;;) {
+		k_spinlock_key_t key = k_spin_lock(&lock);
+
+		hdr = ring_alloc(type, len);
+		k_spin_unlock(&lock, key);
+
+		if (hdr) {
+			break;
+		}
+
+		if (K_TIMEOUT_EQ(timeout, K_NO_WAIT) ||
+		    k_sem_take(&space_sem, timeout)) {
+			atomic_inc(&stats.dropped);
+			return NULL;
+		}
+	}
+
+	return hdr + 1;
+}
+
+void telemetry_commit(void *payload)
+{
+	struct record_hdr *hdr = (struct record_hdr *)payload - 1;
+	k_spinlock_key_t key = k_spin_lock(&lock);
+
+	hdr->state = RECORD_COMMITTED;
+	if (!tx_busy) {
+		tx_busy = true;
+		uart_irq_tx_enable(tx_uart);
+	}
+
+	k_spin_unlock(&lock, key);
+}
+
+/* Start of the current stats interval */
+static uint32_t last_cycles;
+static uint64_t last_exec_cycles;
+
+/* Cycles spent outside the idle thread; execution_cycles counts the idle
+ * thread too and would read as a busy CPU.
+ */
+static uint64_t exec_cycles_get(void)
+{
+	k_thread_runtime_stats_t rt;
+
+	if (k_thread_runtime_stats_all_get(&rt)) {
+		return 0;
+	}
+
+	return rt.total_cycles;
+}
+
+/* A thread of its own rather than a work item: the CDC ACM driver runs
+ * its interrupt callback from the system workqueue, so waiting there for
+ * ring space would never see any freed.
+ */
+static void stats_thread(void)
+{
+	uint32_t last_isr_cycles = 0;
+
+	while (1) {
+		k_sleep(K_MSEC(CONFIG_CONSOLE_TELEMETRY_STATS_MS));
+
+		uint32_t now = k_cycle_get_32();
+		uint32_t elapsed = MAX(now - last_cycles, 1U);
+		uint32_t isr_cycles = stats.isr_cycles;
+		uint64_t exec_cycles = exec_cycles_get();
+		struct telemetry_stats *s;
+
+		/* Higher priority than the producers, so it gets the next
+		 * free space even when they keep the ring full.
+		 */
+		s = telemetry_claim(TELEMETRY_STATS, sizeof(*s), K_FOREVER);
+		if (s) {
+			s->uptime_ms = sys_cpu_to_le32(k_uptime_get_32());
+			s->frames = sys_cpu_to_le32(stats.frames);
+			s->bytes = sys_cpu_to_le32(stats.bytes);
+			s->dropped = sys_cpu_to_le32(atomic_get(&stats.dropped));
+			s->isr_permille = sys_cpu_to_le16(
+				(uint64_t)(isr_cycles - last_isr_cycles) *
+				1000U / elapsed);
+			s->cpu_permille = sys_cpu_to_le16(
+				MIN((exec_cycles - last_exec_cycles) * 1000U /
+				    elapsed, 1000U));
+			telemetry_commit(s);
+		}
+
+		last_cycles = now;
+		last_isr_cycles = isr_cycles;
+		last_exec_cycles = exec_cycles;
+	}
+}
+
+K_THREAD_DEFINE(telemetry_stats, 512, stats_thread, NULL, NULL, NULL, 5, 0,
+		SYS_FOREVER_MS);
+
+int telemetry_start(const struct device *uart)
+{
+	int err;
+
+	if (!device_is_ready(uart)) {
+		return -ENODEV;
+	}
+
+	tx_uart = uart;
+	err = uart_irq_callback_set(uart, uart_isr);
+	if (err) {
+		return err;
+	}
+
+	last_cycles = k_cycle_get_32();
+	last_exec_cycles = exec_cycles_get();
+	k_thread_start(telemetry_stats);
+
+	return 0;
+}
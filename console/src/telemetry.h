@@ -0,0 +1,54 @@
+/** @file
+ *  @brief Framed binary telemetry over an interrupt driven UART
+ *
+ *  Each record goes out as one frame: COBS over the record type, the
+ *  payload and a CRC-16 of both, terminated by a zero byte. See
+ *  scripts/decode.py for the host side.
+ */
+
+/*
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <zephyr/types.h>
+#include <zephyr/device.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+enum telemetry_type {
+	/* struct telemetry_stats, every CONFIG_CONSOLE_TELEMETRY_STATS_MS */
+	TELEMETRY_STATS = 0,
+	/* u32 seq, u32 cycle count, then padding */
+	TELEMETRY_SAMPLE = 1,
+};
+
+/* Little-endian on the wire */
+struct telemetry_stats {
+	uint32_t uptime_ms;
+	/* Totals since telemetry_start() */
+	uint32_t frames;
+	uint32_t bytes;
+	uint32_t dropped;
+	/* Share of the last interval, in 1/1000 */
+	uint16_t isr_permille;
+	uint16_t cpu_permille;
+} __packed;
+
+int telemetry_start(const struct device *uart);
+
+/* Reserve room for a record of len bytes and return its payload, to be
+ * filled in place and handed to telemetry_commit(). Waits up to timeout
+ * each time the transmitter frees space; returns NULL, and counts the
+ * record as dropped, if there is still none. Use K_NO_WAIT from ISRs.
+ */
+void *telemetry_claim(enum telemetry_type type, size_t len,
+		      k_timeout_t timeout);
+
+/* Queue a claimed record for transmission; safe from ISRs */
+void telemetry_commit(void *payload);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,187 @@
+/** @file
+ *  @brief Keypress broadcast over periodic advertising
+ *
+ *  The periodic advertising train carries the most recent key edges as
+ *  128-bit service data: the vendor service UUID followed by a PRESS
+ *  payload (see press_record.h). Each edge stays in the train for the
+ *  next CONFIG_PERIPHERAL_BROADCAST_RECORDS edges, so a listener that
+ *  misses a few events still sees it; the sequence numbers let it drop
+ *  repeats and count real losses.
+ */
+
+/*
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <zephyr/types.h>
+#include <stddef.h>
+#include <errno.h>
+#include <zephyr/zephyr.h>
+#include <zephyr/sys/printk.h>
+#include <zephyr/sys/byteorder.h>
+
+#include <zephyr/bluetooth/bluetooth.h>
+#include <zephyr/bluetooth/uuid.h>
+
+#include "broadcast.h"
+#include "event_bus.h"
+#include "press_record.h"
+#include "vnd_uuid.h"
+
+#define RECORDS CONFIG_PERIPHERAL_BROADCAST_RECORDS
+/* Periodic advertising interval is in 1.25 ms units */
+#define PER_ADV_INTERVAL (CONFIG_PERIPHERAL_BROADCAST_INTERVAL_MS * 4 / 5)
+
+struct broadcast_edge {
+	int64_t timestamp;
+	uint16_t seq;
+	uint8_t key;
+	bool down;
+};
+
+static struct bt_le_ext_adv *adv;
+static struct broadcast_edge recent[RECORDS];
+static uint8_t recent_next;
+static uint8_t recent_count;
+
+static uint8_t svc_data[BT_UUID_SIZE_128 + PRESS_HEADER_SIZE +
+			RECORDS * PRESS_RECORD_SIZE] = {
+	BT_UUID_CUSTOM_SERVICE_KEY
+};
+
+/* The AD structure adds its length and type bytes to the service data */
+#if defined(CONFIG_BT_CTLR_ADV_DATA_LEN_MAX)
+BUILD_ASSERT(2 + sizeof(svc_data) <= CONFIG_BT_CTLR_ADV_DATA_LEN_MAX,
+	     "CONFIG_BT_CTLR_ADV_DATA_LEN_MAX too small for the broadcast "
+	     "records, see overlay-broadcast.conf");
+#endif
+
+/* Fed by the event bus directly, so edges reach the train even while
+ * PRESS notifications are backed off for lack of buffers.
+ */
+static void broadcast_work_handler(struct k_work *work);
+static K_WORK_DELAYABLE_DEFINE(broadcast_work, broadcast_work_handler);
+EVENT_SUB_DEFINE(broadcast_sub, BIT(EVENT_CHAN_KEY),
+		 CONFIG_PERIPHERAL_PRESS_QUEUE_SIZE, &broadcast_work);
+
+static const struct bt_data ad[] = {
+	BT_DATA_BYTES(BT_DATA_UUID128_ALL, BT_UUID_CUSTOM_SERVICE_KEY),
+};
+
+static void broadcast_add(uint16_t seq, uint8_t key, bool down,
+			  int64_t timestamp)
+{
+	recent[recent_next] = (struct broadcast_edge) {
+		.timestamp = timestamp,
+		.seq = seq,
+		.key = key,
+		.down = down,
+	};
+	recent_next = (recent_next + 1) % RECORDS;
+	recent_count = MIN(recent_count + 1, RECORDS);
+}
+
+static void broadcast_flush(void)
+{
+	size_t len = BT_UUID_SIZE_128 + PRESS_HEADER_SIZE;
+	uint8_t first = (recent_next + RECORDS - recent_count) % RECORDS;
+	int64_t last_timestamp = recent[first].timestamp;
+	struct bt_data data;
+	int err;
+
+	if (!adv) {
+		return;
+	}
+
+	sys_put_le32(press_clock_us(last_timestamp),
+		     &svc_data[BT_UUID_SIZE_128]);
+
+	/* Oldest first, so deltas stay positive */
+	for (uint8_t i = 0; i < recent_count; i++) {
+		const struct broadcast_edge *edge = &recent[(first + i) % RECORDS];
+		int64_t ms = k_ticks_to_ms_floor64(edge->timestamp -
+						   last_timestamp);
+		struct press_record rec = {
+			.seq = edge->seq,
+			.key = edge->key,
+			.down = edge->down,
+			.delta_ms = MIN(ms, UINT16_MAX),
+		};
+
+		last_timestamp = edge->timestamp;
+		press_record_encode(&rec, &svc_data[len]);
+		len += PRESS_RECORD_SIZE;
+	}
+
+	data.type = BT_DATA_SVC_DATA128;
+	data.data_len = len;
+	data.data = svc_data;
+
+	err = bt_le_per_adv_set_data(adv, &data, 1);
+	if (err) {
+		printk("Broadcast update failed (err %d)\n", err);
+	}
+}
+
+static void broadcast_work_handler(struct k_work *work)
+{
+	const struct event *ev;
+	bool added = false;
+
+	while ((ev = event_bus_get(&broadcast_sub, K_NO_WAIT))) {
+		broadcast_add(ev->key.seq, ev->key.key, ev->key.down,
+			      ev->key.timestamp);
+		event_bus_release(ev);
+		added = true;
+	}
+
+	/* One data update for however many edges were queued */
+	if (added) {
+		broadcast_flush();
+	}
+}
+
+int broadcast_start(uint32_t origin)
+{
+	int err;
+
+	sys_put_le32(origin, &svc_data[BT_UUID_SIZE_128 + 4]);
+
+	err = bt_le_ext_adv_create(BT_LE_EXT_ADV_NCONN_NAME, NULL, &adv);
+	if (err) {
+		printk("Broadcast set failed (err %d)\n", err);
+		return err;
+	}
+
+	err = bt_le_ext_adv_set_data(adv, ad, ARRAY_SIZE(ad), NULL, 0);
+	if (err) {
+		return err;
+	}
+
+	err = bt_le_per_adv_set_param(adv,
+				      BT_LE_PER_ADV_PARAM(PER_ADV_INTERVAL,
+							  PER_ADV_INTERVAL,
+							  BT_LE_PER_ADV_OPT_NONE));
+	if (err) {
+		return err;
+	}
+
+	broadcast_flush();
+
+	err = bt_le_per_adv_start(adv);
+	if (err) {
+		return err;
+	}
+
+	err = bt_le_ext_adv_start(adv, BT_LE_EXT_ADV_START_DEFAULT);
+	if (err) {
+		return err;
+	}
+
+	event_bus_subscribe(&broadcast_sub);
+
+	printk("Broadcasting presses every %d ms\n",
+	       CONFIG_PERIPHERAL_BROADCAST_INTERVAL_MS);
+
+	return 0;
+}
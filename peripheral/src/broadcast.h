@@ -0,0 +1,22 @@
+/** @file
+ *  @brief Keypress broadcast over periodic advertising
+ */
+
+/*
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <zephyr/types.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Starts the train under the given press origin; key edges published on
+ * the event bus follow.
+ */
+int broadcast_start(uint32_t origin);
+
+#ifdef __cplusplus
+}
+#endif
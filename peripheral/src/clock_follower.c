@@ -0,0 +1,209 @@
+/** @file
+ *  @brief Follows the central's microsecond timebase
+ *
+ *  The shared clock is a line through the last anchor: an offset from
+ *  local uptime plus a skew in parts per billion. Every sample from the
+ *  central refines the skew against the previous sample and pulls the
+ *  anchor halfway towards the measured value, so corrections stay smooth
+ *  for the LEDs. The residual between prediction and sample is the sync
+ *  error and is reported periodically.
+ */
+
+/*
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <zephyr/types.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <zephyr/zephyr.h>
+#include <zephyr/sys/printk.h>
+#include <zephyr/sys/byteorder.h>
+#include <zephyr/logging/log.h>
+
+#include <zephyr/bluetooth/bluetooth.h>
+#include <zephyr/bluetooth/gatt.h>
+
+#include "led_engine.h"
+#include "time_sync.h"
+#include "clock_follower.h"
+
+LOG_MODULE_DECLARE(peripheral, CONFIG_PERIPHERAL_LOG_LEVEL);
+
+#define NSEC_PER_SEC_LL 1000000000LL
+/* Samples closer than this give a poor skew estimate */
+#define SKEW_MIN_SPAN_US (1 * USEC_PER_SEC)
+/* Residuals above this mean the central restarted, not drift */
+#define STEP_THRESHOLD_US 5000
+#define STATS_SAMPLES 16
+
+static struct k_spinlock lock;
+static bool synced;
+static int64_t anchor_local;
+static int64_t anchor_shared;
+static int32_t skew_ppb;
+/* Last raw sample, the skew is measured between consecutive ones */
+static int64_t last_local;
+static int64_t last_shared;
+
+static struct {
+	uint32_t samples;
+	uint32_t abs_sum_us;
+	uint32_t abs_max_us;
+	uint32_t steps;
+} stats;
+
+static int64_t local_us(void)
+{
+	return k_ticks_to_us_floor64(k_uptime_ticks());
+}
+
+/* Must hold lock */
+static int64_t to_shared(int64_t local)
+{
+	int64_t dt = local - anchor_local;
+
+	if (!synced) {
+		return local;
+	}
+
+	return anchor_shared + dt + dt * skew_ppb / NSEC_PER_SEC_LL;
+}
+
+/* Must hold lock */
+static int64_t to_local(int64_t shared)
+{
+	int64_t ds = shared - anchor_shared;
+
+	if (!synced) {
+		return shared;
+	}
+
+	/* First order inverse, skew is far below one part per thousand */
+	return anchor_local + ds - ds * skew_ppb / NSEC_PER_SEC_LL;
+}
+
+uint64_t clock_follower_now_us(void)
+{
+	k_spinlock_key_t key = k_spin_lock(&lock);
+	int64_t now = to_shared(local_us());
+
+	k_spin_unlock(&lock, key);
+
+	return now;
+}
+
+uint32_t clock_follower_now_ms(void)
+{
+	return clock_follower_now_us() / USEC_PER_MSEC;
+}
+
+void clock_follower_timer_start(struct k_timer *timer, uint64_t shared_us)
+{
+	k_spinlock_key_t key = k_spin_lock(&lock);
+	int64_t local = to_local(shared_us);
+
+	k_spin_unlock(&lock, key);
+
+	k_timer_start(timer,
+		      K_TIMEOUT_ABS_TICKS(k_us_to_ticks_ceil64(MAX(local, 0))),
+		      K_NO_WAIT);
+}
+
+static void stats_print(void)
+{
+	printk("[SYNC] residual avg %u us max %u us over %u samples, "
+	       "skew %d ppb, %u steps\n",
+	       stats.abs_sum_us / stats.samples, stats.abs_max_us,
+	       stats.samples, skew_ppb, stats.steps);
+	memset(&stats, 0, sizeof(stats));
+}
+
+static void sync_sample(uint32_t peer_us, int64_t shared)
+{
+	int64_t now = local_us();
+	/* CLOCK is the low 32 bits of the same uptime */
+	int64_t local = now - (uint32_t)((uint32_t)now - peer_us);
+	k_spinlock_key_t key = k_spin_lock(&lock);
+	int64_t residual = shared - to_shared(local);
+
+	if (!synced || llabs(residual) > STEP_THRESHOLD_US) {
+		if (synced) {
+			stats.steps++;
+		}
+		synced = true;
+		skew_ppb = 0;
+		anchor_local = local;
+		anchor_shared = shared;
+	} else {
+		int64_t span = local - last_local;
+
+		if (span >= SKEW_MIN_SPAN_US) {
+			int64_t measured = (shared - last_shared - span) *
+					   NSEC_PER_SEC_LL / span;
+
+			skew_ppb += (int32_t)((measured - skew_ppb) / 4);
+		}
+
+		/* Re-anchor on the prediction pulled halfway to the sample */
+		anchor_shared = to_shared(local) + residual / 2;
+		anchor_local = local;
+
+		stats.samples++;
+		stats.abs_sum_us += (uint32_t)llabs(residual);
+		stats.abs_max_us = MAX(stats.abs_max_us,
+				       (uint32_t)llabs(residual));
+	}
+
+	last_local = local;
+	last_shared = shared;
+
+	k_spin_unlock(&lock, key);
+
+	if (stats.samples == STATS_SAMPLES) {
+		stats_print();
+	}
+}
+
+#if defined(CONFIG_LED_ENGINE)
+static uint64_t effect_at;
+static uint8_t effect_next;
+
+static void effect_timer_expired(struct k_timer *timer)
+{
+	led_engine_set_effect(effect_next);
+	/* Timer expiry runs in the ISR, so only queue the message */
+	LOG_INF("[SYNC] effect %u, %d us after the shared instant",
+		effect_next, (int32_t)(clock_follower_now_us() - effect_at));
+}
+
+static K_TIMER_DEFINE(effect_timer, effect_timer_expired, NULL);
+#endif
+
+ssize_t clock_follower_write(struct bt_conn *conn,
+			     const struct bt_gatt_attr *attr, const void *buf,
+			     uint16_t len, uint16_t offset, uint8_t flags)
+{
+	const uint8_t *data = buf;
+
+	if (offset) {
+		return BT_GATT_ERR(BT_ATT_ERR_INVALID_OFFSET);
+	}
+
+	if (len == TIME_SYNC_SAMPLE_SIZE && data[0] == TIME_SYNC_OP_SAMPLE) {
+		sync_sample(sys_get_le32(&data[1]), sys_get_le64(&data[5]));
+	} else if (len == TIME_SYNC_EFFECT_SIZE &&
+		   data[0] == TIME_SYNC_OP_EFFECT) {
+#if defined(CONFIG_LED_ENGINE)
+		effect_at = sys_get_le64(&data[1]);
+		effect_next = data[9];
+		clock_follower_timer_start(&effect_timer, effect_at);
+#endif
+	} else {
+		return BT_GATT_ERR(BT_ATT_ERR_VALUE_NOT_ALLOWED);
+	}
+
+	return len;
+}
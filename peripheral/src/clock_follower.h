@@ -0,0 +1,34 @@
+/** @file
+ *  @brief Follows the central's microsecond timebase
+ *
+ *  Not to be confused with time_sync.h, which only describes the SYNC
+ *  characteristic both sides share.
+ */
+
+/*
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <zephyr/types.h>
+#include <zephyr/kernel.h>
+#include <zephyr/bluetooth/gatt.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Shared time now; falls back to local uptime until the first sample */
+uint64_t clock_follower_now_us(void);
+uint32_t clock_follower_now_ms(void);
+
+/* Start a one-shot timer expiring at the given shared time */
+void clock_follower_timer_start(struct k_timer *timer, uint64_t shared_us);
+
+/* Write handler of the SYNC characteristic, see time_sync.h */
+ssize_t clock_follower_write(struct bt_conn *conn,
+			     const struct bt_gatt_attr *attr, const void *buf,
+			     uint16_t len, uint16_t offset, uint8_t flags);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,80 @@
+/** @file
+ *  @brief Current Time characteristic value and wall clock anchor
+ */
+
+/*
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <zephyr/types.h>
+#include <errno.h>
+#include <time.h>
+#include <zephyr/sys/byteorder.h>
+#include <zephyr/sys/timeutil.h>
+#include <zephyr/sys/util.h>
+#include <zephyr/zephyr.h>
+
+#include "ct_codec.h"
+
+void ct_encode(int64_t epoch_ms, uint8_t reason, uint8_t *buf)
+{
+	time_t sec = epoch_ms / MSEC_PER_SEC;
+	struct tm tm;
+
+	gmtime_r(&sec, &tm);
+
+	/* 'Exact Time 256' contains 'Day Date Time' which contains
+	 * 'Date Time' - characteristic contains fields for:
+	 * year, month, day, hours, minutes and seconds.
+	 */
+	sys_put_le16(tm.tm_year + 1900, buf);
+	buf[2] = tm.tm_mon + 1; /* months starting from 1 */
+	buf[3] = tm.tm_mday;
+	buf[4] = tm.tm_hour;
+	buf[5] = tm.tm_min;
+	buf[6] = tm.tm_sec;
+
+	/* 'Day of Week' part of 'Day Date Time', Monday is 1 */
+	buf[7] = tm.tm_wday ? tm.tm_wday : 7;
+
+	/* 'Fractions 256' part of 'Exact Time 256' */
+	buf[8] = (epoch_ms % MSEC_PER_SEC) * 256 / MSEC_PER_SEC;
+
+	buf[9] = reason;
+}
+
+/* Rejects unknown (zero) and out of range fields; the day of week is
+ * only range checked since it follows from the date.
+ */
+int ct_decode(const uint8_t *buf, int64_t *epoch_ms)
+{
+	static const uint8_t days[] = {
+		31, 29, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31
+	};
+	uint16_t year = sys_get_le16(buf);
+	struct tm tm = {
+		.tm_year = year - 1900,
+		.tm_mon = buf[2] - 1,
+		.tm_mday = buf[3],
+		.tm_hour = buf[4],
+		.tm_min = buf[5],
+		.tm_sec = buf[6],
+	};
+
+	if (year < 1970 || year > 9999 || buf[2] < 1 || buf[2] > 12 ||
+	    buf[3] < 1 || buf[3] > days[buf[2] - 1] || buf[4] > 23 ||
+	    buf[5] > 59 || buf[6] > 59 || buf[7] > 7) {
+		return -EINVAL;
+	}
+
+	/* February 29th outside leap years */
+	if (buf[2] == 2 && buf[3] == 29 &&
+	    (year % 4 || (year % 100 == 0 && year % 400))) {
+		return -EINVAL;
+	}
+
+	*epoch_ms = timeutil_timegm64(&tm) * MSEC_PER_SEC +
+		    buf[8] * MSEC_PER_SEC / 256;
+
+	return 0;
+}
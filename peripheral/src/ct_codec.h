@@ -0,0 +1,48 @@
+/** @file
+ *  @brief Current Time characteristic value and wall clock anchor
+ */
+
+/*
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <zephyr/types.h>
+#include <zephyr/sys/util.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Size of the Current Time value: Exact Time 256 plus Adjust Reason */
+#define CT_LEN 10
+
+/* Adjust Reason flags */
+#define CT_ADJUST_MANUAL BIT(0)
+#define CT_ADJUST_EXTERNAL BIT(1)
+#define CT_ADJUST_TIME_ZONE BIT(2)
+#define CT_ADJUST_DST BIT(3)
+#define CT_ADJUST_MASK BIT_MASK(4)
+
+/* Wall clock in ms since the epoch at a given uptime. Reads extrapolate
+ * from here, so nothing needs to tick.
+ */
+struct ct_anchor {
+	int64_t epoch_ms;
+	int64_t uptime_ms;
+};
+
+static inline int64_t ct_anchor_now_ms(const struct ct_anchor *anchor,
+				       int64_t uptime_ms)
+{
+	return anchor->epoch_ms + uptime_ms - anchor->uptime_ms;
+}
+
+/* Encodes CT_LEN bytes into buf */
+void ct_encode(int64_t epoch_ms, uint8_t reason, uint8_t *buf);
+
+/* Decodes CT_LEN bytes; -EINVAL for unknown or out of range fields */
+int ct_decode(const uint8_t *buf, int64_t *epoch_ms);
+
+#ifdef __cplusplus
+}
+#endif
@@ -10,10 +10,13 @@
 
 #include <zephyr/types.h>
 #include <stddef.h>
+#include <stdlib.h>
 #include <string.h>
 #include <errno.h>
+#include <time.h>
 #include <zephyr/sys/printk.h>
 #include <zephyr/sys/byteorder.h>
+#include <zephyr/sys/timeutil.h>
 #include <zephyr/zephyr.h>
 
 #include <zephyr/bluetooth/bluetooth.h>
@@ -22,35 +25,94 @@
 #include <zephyr/bluetooth/uuid.h>
 #include <zephyr/bluetooth/gatt.h>
 
-static uint8_t ct[10];
-static uint8_t ct_update;
+#include "clock_follower.h"
+#include "ct_codec.h"
+#include "cts.h"
+#include "subscription.h"
+#include "time_sync.h"
+
+static const struct bt_uuid_128 sync_uuid =
+	BT_UUID_INIT_128(BT_UUID_CUSTOM_SERVICE_SYNC);
+
+/* Guards the anchor and the reason given by the write that set it */
+static struct k_spinlock ct_lock;
+static struct ct_anchor anchor;
+static uint8_t adjust_reason;
+static struct notify_count ct_count;
+
+static void ct_notify_handler(struct k_work *work);
+static K_WORK_DEFINE(ct_work, ct_notify_handler);
+
+static int64_t ct_now_ms(void)
+{
+	k_spinlock_key_t key = k_spin_lock(&ct_lock);
+	int64_t now = ct_anchor_now_ms(&anchor, k_uptime_get());
+
+	k_spin_unlock(&ct_lock, key);
+
+	return now;
+}
 
 static void ct_ccc_cfg_changed(const struct bt_gatt_attr *attr, uint16_t value)
 {
-	/* TODO: Handle value */
+	printk("CTS notifications %s\n",
+	       value == BT_GATT_CCC_NOTIFY ? "enabled" : "disabled");
 }
 
 static ssize_t read_ct(struct bt_conn *conn, const struct bt_gatt_attr *attr,
 		       void *buf, uint16_t len, uint16_t offset)
 {
-	const char *value = attr->user_data;
+	uint8_t value[CT_LEN];
+
+	ct_encode(ct_now_ms(), 0, value);
 
 	return bt_gatt_attr_read(conn, attr, buf, len, offset, value,
-				 sizeof(ct));
+				 sizeof(value));
 }
 
 static ssize_t write_ct(struct bt_conn *conn, const struct bt_gatt_attr *attr,
 			const void *buf, uint16_t len, uint16_t offset,
 			uint8_t flags)
 {
-	uint8_t *value = attr->user_data;
+	const uint8_t *value = buf;
+	k_spinlock_key_t key;
+	int64_t epoch_ms, now;
 
-	if (offset + len > sizeof(ct)) {
+	if (offset) {
 		return BT_GATT_ERR(BT_ATT_ERR_INVALID_OFFSET);
 	}
 
-	memcpy(value + offset, buf, len);
-	ct_update = 1U;
+	if (len != CT_LEN) {
+		return BT_GATT_ERR(BT_ATT_ERR_INVALID_ATTRIBUTE_LEN);
+	}
+
+	if (ct_decode(value, &epoch_ms)) {
+		return BT_GATT_ERR(BT_ATT_ERR_OUT_OF_RANGE);
+	}
+
+	key = k_spin_lock(&ct_lock);
+	now = k_uptime_get();
+
+	/* Current Time Service updates only when time is changed; anything
+	 * within one fraction of our own clock is not an adjustment.
+	 */
+	if (llabs(ct_anchor_now_ms(&anchor, now) - epoch_ms) <
+	    MSEC_PER_SEC / 256) {
+		k_spin_unlock(&ct_lock, key);
+		ct_count.suppressed++;
+		return len;
+	}
+
+	anchor.epoch_ms = epoch_ms;
+	anchor.uptime_ms = now;
+	adjust_reason = value[9] & CT_ADJUST_MASK;
+	if (!adjust_reason) {
+		adjust_reason = CT_ADJUST_MANUAL;
+	}
+
+	k_spin_unlock(&ct_lock, key);
+
+	k_work_submit(&ct_work);
 
 	return len;
 }
@@ -61,49 +123,61 @@ BT_GATT_SERVICE_DEFINE(cts_cvs,
 	BT_GATT_CHARACTERISTIC(BT_UUID_CTS_CURRENT_TIME, BT_GATT_CHRC_READ |
 			       BT_GATT_CHRC_NOTIFY | BT_GATT_CHRC_WRITE,
 			       BT_GATT_PERM_READ | BT_GATT_PERM_WRITE,
-			       read_ct, write_ct, ct),
+			       read_ct, write_ct, NULL),
 	BT_GATT_CCC(ct_ccc_cfg_changed, BT_GATT_PERM_READ | BT_GATT_PERM_WRITE),
+	/* Vendor extension: the central disciplines our shared timebase */
+	BT_GATT_CHARACTERISTIC(&sync_uuid.uuid,
+			       BT_GATT_CHRC_WRITE_WITHOUT_RESP,
+			       BT_GATT_PERM_WRITE, NULL, clock_follower_write,
+			       NULL),
 );
 
-static void generate_current_time(uint8_t *buf)
+void cts_init(void)
 {
-	uint16_t year;
+	/* Until a client sets the time, start at the sample's old default */
+	struct tm tm = {
+		.tm_year = 2015 - 1900,
+		.tm_mon = 5 - 1,
+		.tm_mday = 30,
+		.tm_hour = 12,
+		.tm_min = 45,
+		.tm_sec = 30,
+	};
+	int64_t epoch_ms = timeutil_timegm64(&tm) * MSEC_PER_SEC;
+	k_spinlock_key_t key = k_spin_lock(&ct_lock);
+
+	anchor.epoch_ms = epoch_ms;
+	anchor.uptime_ms = k_uptime_get();
+
+	k_spin_unlock(&ct_lock, key);
+}
 
-	/* 'Exact Time 256' contains 'Day Date Time' which contains
-	 * 'Date Time' - characteristic contains fields for:
-	 * year, month, day, hours, minutes and seconds.
-	 */
+static void ct_notify_handler(struct k_work *work)
+{
+	uint8_t value[CT_LEN];
+	k_spinlock_key_t key;
+	int64_t now_ms;
+	uint8_t reason;
 
-	year = sys_cpu_to_le16(2015);
-	memcpy(buf,  &year, 2); /* year */
-	buf[2] = 5U; /* months starting from 1 */
-	buf[3] = 30U; /* day */
-	buf[4] = 12U; /* hours */
-	buf[5] = 45U; /* minutes */
-	buf[6] = 30U; /* seconds */
+	if (!subscription_any(&cts_cvs.attrs[1])) {
+		ct_count.suppressed++;
+		return;
+	}
 
-	/* 'Day of Week' part of 'Day Date Time' */
-	buf[7] = 1U; /* day of week starting from 1 */
+	/* Time and reason from the same write */
+	key = k_spin_lock(&ct_lock);
+	now_ms = ct_anchor_now_ms(&anchor, k_uptime_get());
+	reason = adjust_reason;
+	k_spin_unlock(&ct_lock, key);
 
-	/* 'Fractions 256 part of 'Exact Time 256' */
-	buf[8] = 0U;
+	ct_encode(now_ms, reason, value);
 
-	/* Adjust reason */
-	buf[9] = 0U; /* No update, change, etc */
+	if (!bt_gatt_notify(NULL, &cts_cvs.attrs[1], value, sizeof(value))) {
+		ct_count.sent++;
+	}
 }
 
-void cts_init(void)
+const struct notify_count *cts_notify_count(void)
 {
-	/* Simulate current time for Current Time Service */
-	generate_current_time(ct);
-}
-
-void cts_notify(void)
-{	/* Current Time Service updates only when time is changed */
-	if (!ct_update) {
-		return;
-	}
-
-	ct_update = 0U;
-	bt_gatt_notify(NULL, &cts_cvs.attrs[1], &ct, sizeof(ct));
+	return &ct_count;
 }
@@ -12,8 +12,11 @@
 extern "C" {
 #endif
 
+struct notify_count;
+
 void cts_init(void);
-void cts_notify(void);
+/* Time notifications sent, and skipped as unchanged or unsubscribed */
+const struct notify_count *cts_notify_count(void);
 
 #ifdef __cplusplus
 }
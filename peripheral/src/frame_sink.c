@@ -0,0 +1,154 @@
+/** @file
+ *  @brief LED frames uploaded by the central
+ *
+ *  Each SDU patches the last frame received on the channel; complete
+ *  frames go to the LED engine. Returning from recv hands the credit
+ *  back to the central, so a slow strip throttles the sender.
+ */
+
+/*
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <zephyr/types.h>
+#include <stddef.h>
+#include <string.h>
+#include <errno.h>
+#include <zephyr/zephyr.h>
+#include <zephyr/sys/printk.h>
+#include <zephyr/net/buf.h>
+
+#include <zephyr/bluetooth/bluetooth.h>
+#include <zephyr/bluetooth/conn.h>
+#include <zephyr/bluetooth/l2cap.h>
+
+#include "frame_sink.h"
+#include "led_engine.h"
+#include "led_frame.h"
+
+#define PIXELS CONFIG_LED_UPLOAD_PIXELS
+#define STATS_INTERVAL_MS 5000
+
+NET_BUF_POOL_FIXED_DEFINE(sink_pool, CONFIG_BT_MAX_CONN,
+			  BT_L2CAP_SDU_BUF_SIZE(CONFIG_LED_UPLOAD_MTU),
+			  CONFIG_BT_CONN_TX_USER_DATA_SIZE, NULL);
+
+struct sink_chan {
+	struct bt_l2cap_le_chan le;
+	struct led_rgb frame[PIXELS];
+
+	int64_t window_start;
+	uint32_t frames;
+	uint32_t bytes;
+	uint32_t errors;
+};
+
+static struct sink_chan chans[CONFIG_BT_MAX_CONN];
+
+static void sink_stats_print(struct sink_chan *sc, int64_t now)
+{
+	uint32_t elapsed = MAX(now - sc->window_start, 1);
+	uint32_t rate = (uint64_t)sc->bytes * 100U / elapsed;
+
+	printk("[FRAMES] %u.%02u kB/s, %u frames, %u bad SDUs\n",
+	       rate / 100U, rate % 100U, sc->frames, sc->errors);
+
+	sc->window_start = now;
+	sc->frames = 0;
+	sc->bytes = 0;
+	sc->errors = 0;
+}
+
+static struct net_buf *sink_alloc_buf(struct bt_l2cap_chan *chan)
+{
+	return net_buf_alloc(&sink_pool, K_FOREVER);
+}
+
+static int sink_recv(struct bt_l2cap_chan *chan, struct net_buf *buf)
+{
+	struct sink_chan *sc = CONTAINER_OF(chan, struct sink_chan, le.chan);
+	int64_t now = k_uptime_get();
+	uint8_t flags;
+
+	sc->bytes += buf->len;
+
+	if (buf->len < LED_FRAME_HEADER_SIZE) {
+		sc->errors++;
+		return 0;
+	}
+
+	/* Frame number, only useful when tracing */
+	(void)net_buf_pull_le16(buf);
+	flags = net_buf_pull_u8(buf);
+
+	if (flags & LED_FRAME_RESET) {
+		memset(sc->frame, 0, sizeof(sc->frame));
+	}
+
+	if (led_frame_decode(sc->frame, PIXELS, buf->data, buf->len)) {
+		sc->errors++;
+	}
+
+	if (flags & LED_FRAME_END) {
+		sc->frames++;
+		if (IS_ENABLED(CONFIG_LED_ENGINE)) {
+			led_engine_show(sc->frame, PIXELS);
+		}
+	}
+
+	if (now - sc->window_start >= STATS_INTERVAL_MS) {
+		sink_stats_print(sc, now);
+	}
+
+	return 0;
+}
+
+static void sink_connected(struct bt_l2cap_chan *chan)
+{
+	struct sink_chan *sc = CONTAINER_OF(chan, struct sink_chan, le.chan);
+
+	printk("[FRAMES] channel up, rx mtu %u mps %u\n", sc->le.rx.mtu,
+	       sc->le.rx.mps);
+	sc->window_start = k_uptime_get();
+}
+
+static void sink_disconnected(struct bt_l2cap_chan *chan)
+{
+	struct sink_chan *sc = CONTAINER_OF(chan, struct sink_chan, le.chan);
+
+	sink_stats_print(sc, k_uptime_get());
+}
+
+static const struct bt_l2cap_chan_ops sink_ops = {
+	.alloc_buf = sink_alloc_buf,
+	.recv = sink_recv,
+	.connected = sink_connected,
+	.disconnected = sink_disconnected,
+};
+
+static int sink_accept(struct bt_conn *conn, struct bt_l2cap_chan **chan)
+{
+	struct sink_chan *sc = &chans[bt_conn_index(conn)];
+
+	if (sc->le.chan.conn) {
+		return -ENOMEM;
+	}
+
+	memset(sc, 0, sizeof(*sc));
+	sc->le.chan.ops = &sink_ops;
+	sc->le.rx.mtu = CONFIG_LED_UPLOAD_MTU;
+	*chan = &sc->le.chan;
+
+	return 0;
+}
+
+static struct bt_l2cap_server sink_server = {
+	.psm = LED_FRAME_PSM,
+	.sec_level = BT_SECURITY_L1,
+	.accept = sink_accept,
+};
+
+int frame_sink_init(void)
+{
+	return bt_l2cap_server_register(&sink_server);
+}
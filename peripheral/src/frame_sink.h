@@ -0,0 +1,18 @@
+/** @file
+ *  @brief LED frames uploaded by the central
+ */
+
+/*
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Start listening for the central's frame channel */
+int frame_sink_init(void);
+
+#ifdef __cplusplus
+}
+#endif
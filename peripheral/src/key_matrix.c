@@ -0,0 +1,251 @@
+/** @file
+ *  @brief Key matrix scanner
+ *
+ *  Idle, all columns are driven and a row interrupt starts scanning.
+ *  While any key is held the matrix is scanned every scan-period-ms into
+ *  a packed bitmap (key = column * rows + row), with full n-key
+ *  rollover. Passes that could contain ghost keys are discarded. Once
+ *  every key is released, scanning stops and the row interrupts are
+ *  armed again.
+ */
+
+/*
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#define DT_DRV_COMPAT tree_key_matrix
+
+#include <zephyr/types.h>
+#include <stddef.h>
+#include <string.h>
+#include <errno.h>
+#include <zephyr/zephyr.h>
+#include <zephyr/device.h>
+#include <zephyr/drivers/gpio.h>
+#include <zephyr/sys/printk.h>
+#include <zephyr/sys/util.h>
+
+#include "key_matrix.h"
+
+#define MATRIX_NODE DT_INST(0, DT_DRV_COMPAT)
+
+#define MATRIX_ROWS DT_PROP_LEN(MATRIX_NODE, row_gpios)
+#define MATRIX_COLS DT_PROP_LEN(MATRIX_NODE, col_gpios)
+#define MATRIX_KEYS (MATRIX_ROWS * MATRIX_COLS)
+#define MATRIX_WORDS DIV_ROUND_UP(MATRIX_KEYS, 32)
+
+/* Row masks are one word, key ids travel in 7 bits of a press record */
+BUILD_ASSERT(MATRIX_ROWS <= 32, "Too many key matrix rows");
+BUILD_ASSERT(MATRIX_KEYS <= 128, "Too many keys for a press record");
+
+#define MATRIX_GPIO_SPEC(node_id, prop, idx) \
+	GPIO_DT_SPEC_GET_BY_IDX(node_id, prop, idx),
+
+static const struct gpio_dt_spec rows[] = {
+	DT_FOREACH_PROP_ELEM(MATRIX_NODE, row_gpios, MATRIX_GPIO_SPEC)
+};
+
+static const struct gpio_dt_spec cols[] = {
+	DT_FOREACH_PROP_ELEM(MATRIX_NODE, col_gpios, MATRIX_GPIO_SPEC)
+};
+
+static struct gpio_callback row_cb_data[MATRIX_ROWS];
+static key_matrix_cb_t matrix_cb;
+
+/* Debounced state reported to matrix_cb, and the previous raw pass */
+static uint32_t state[MATRIX_WORDS];
+static uint32_t last_raw[MATRIX_WORDS];
+
+static struct {
+	uint32_t passes;
+	uint32_t ghosts;
+	uint64_t cycles;
+	uint32_t max_cycles;
+} scan_stats;
+
+static void scan_work_handler(struct k_work *work);
+static K_WORK_DELAYABLE_DEFINE(scan_work, scan_work_handler);
+
+static void rows_interrupt(gpio_flags_t flags)
+{
+	for (size_t i = 0; i < ARRAY_SIZE(rows); i++) {
+		gpio_pin_interrupt_configure_dt(&rows[i], flags);
+	}
+}
+
+static void cols_set_all(int value)
+{
+	for (size_t i = 0; i < ARRAY_SIZE(cols); i++) {
+		gpio_pin_set_dt(&cols[i], value);
+	}
+}
+
+static void row_edge(const struct device *dev, struct gpio_callback *cb,
+		     uint32_t pins)
+{
+	/* Scanning takes over until every key is released */
+	rows_interrupt(GPIO_INT_DISABLE);
+	k_work_reschedule(&scan_work, K_NO_WAIT);
+}
+
+/* Two columns that share two or more rows make a rectangle, and without
+ * diodes its fourth corner reads as pressed whether it is or not.
+ */
+static bool has_ghost(const uint32_t *col_rows)
+{
+	for (size_t a = 0; a < MATRIX_COLS; a++) {
+		for (size_t b = a + 1; b < MATRIX_COLS; b++) {
+			uint32_t common = col_rows[a] & col_rows[b];
+
+			if (common & (common - 1)) {
+				return true;
+			}
+		}
+	}
+
+	return false;
+}
+
+static void scan(uint32_t *raw, uint32_t *col_rows)
+{
+	(void)memset(raw, 0, sizeof(uint32_t) * MATRIX_WORDS);
+
+	cols_set_all(0);
+
+	for (size_t c = 0; c < MATRIX_COLS; c++) {
+		col_rows[c] = 0;
+
+		gpio_pin_set_dt(&cols[c], 1);
+		k_busy_wait(DT_PROP(MATRIX_NODE, settle_us));
+
+		for (size_t r = 0; r < MATRIX_ROWS; r++) {
+			if (gpio_pin_get_dt(&rows[r]) > 0) {
+				size_t key = c * MATRIX_ROWS + r;
+
+				col_rows[c] |= BIT(r);
+				raw[key / 32] |= BIT(key % 32);
+			}
+		}
+
+		gpio_pin_set_dt(&cols[c], 0);
+	}
+}
+
+static void report_changes(const uint32_t *raw, int64_t now)
+{
+	for (size_t w = 0; w < MATRIX_WORDS; w++) {
+		uint32_t diff = state[w] ^ raw[w];
+
+		while (diff) {
+			uint32_t bit = find_lsb_set(diff) - 1;
+			uint8_t key = w * 32 + bit;
+
+			diff &= ~BIT(bit);
+			matrix_cb(key, (raw[w] & BIT(bit)) != 0, now);
+		}
+
+		state[w] = raw[w];
+	}
+}
+
+static bool bitmap_empty(const uint32_t *bitmap)
+{
+	for (size_t w = 0; w < MATRIX_WORDS; w++) {
+		if (bitmap[w]) {
+			return false;
+		}
+	}
+
+	return true;
+}
+
+static void scan_work_handler(struct k_work *work)
+{
+	uint32_t raw[MATRIX_WORDS];
+	uint32_t col_rows[MATRIX_COLS];
+	uint32_t start = k_cycle_get_32();
+	uint32_t cycles;
+
+	scan(raw, col_rows);
+
+	cycles = k_cycle_get_32() - start;
+	scan_stats.passes++;
+	scan_stats.cycles += cycles;
+	scan_stats.max_cycles = MAX(scan_stats.max_cycles, cycles);
+
+	if (has_ghost(col_rows)) {
+		/* Keep the last trustworthy state until the rectangle breaks */
+		scan_stats.ghosts++;
+	} else if (!memcmp(raw, last_raw, sizeof(raw))) {
+		report_changes(raw, k_uptime_ticks());
+	}
+	memcpy(last_raw, raw, sizeof(last_raw));
+
+	if (!bitmap_empty(state) || !bitmap_empty(raw)) {
+		k_work_schedule(&scan_work,
+				K_MSEC(DT_PROP(MATRIX_NODE, scan_period_ms)));
+		return;
+	}
+
+	printk("[MATRIX] %u passes, %u us average, %u us max per pass, "
+	       "%u ghost passes\n", scan_stats.passes,
+	       k_cyc_to_us_floor32(scan_stats.cycles / scan_stats.passes),
+	       k_cyc_to_us_floor32(scan_stats.max_cycles), scan_stats.ghosts);
+
+	/* Idle again: drive every column and wait for a row edge */
+	cols_set_all(1);
+	rows_interrupt(GPIO_INT_EDGE_TO_ACTIVE);
+
+	/* A key that went down before the interrupt was armed gave no edge */
+	for (size_t i = 0; i < ARRAY_SIZE(rows); i++) {
+		if (gpio_pin_get_dt(&rows[i]) > 0) {
+			row_edge(NULL, NULL, 0);
+			break;
+		}
+	}
+}
+
+int key_matrix_init(key_matrix_cb_t cb)
+{
+	int ret;
+
+	matrix_cb = cb;
+
+	for (size_t i = 0; i < ARRAY_SIZE(cols); i++) {
+		if (!device_is_ready(cols[i].port)) {
+			printk("Error: matrix column %s is not ready\n",
+			       cols[i].port->name);
+			return -ENODEV;
+		}
+
+		ret = gpio_pin_configure_dt(&cols[i], GPIO_OUTPUT_ACTIVE);
+		if (ret) {
+			printk("Error %d: failed to configure column %s pin %d\n",
+			       ret, cols[i].port->name, cols[i].pin);
+			return ret;
+		}
+	}
+
+	for (size_t i = 0; i < ARRAY_SIZE(rows); i++) {
+		if (!device_is_ready(rows[i].port)) {
+			printk("Error: matrix row %s is not ready\n",
+			       rows[i].port->name);
+			return -ENODEV;
+		}
+
+		ret = gpio_pin_configure_dt(&rows[i], GPIO_INPUT);
+		if (ret) {
+			printk("Error %d: failed to configure row %s pin %d\n",
+			       ret, rows[i].port->name, rows[i].pin);
+			return ret;
+		}
+
+		gpio_init_callback(&row_cb_data[i], row_edge, BIT(rows[i].pin));
+		gpio_add_callback(rows[i].port, &row_cb_data[i]);
+	}
+
+	rows_interrupt(GPIO_INT_EDGE_TO_ACTIVE);
+	printk("Set up %dx%d key matrix\n", MATRIX_ROWS, MATRIX_COLS);
+
+	return 0;
+}
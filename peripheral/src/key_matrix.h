@@ -0,0 +1,22 @@
+/** @file
+ *  @brief Key matrix scanner
+ */
+
+/*
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <zephyr/types.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Called from the system work queue for every key whose state changed */
+typedef void (*key_matrix_cb_t)(uint8_t key, bool down, int64_t timestamp);
+
+int key_matrix_init(key_matrix_cb_t cb);
+
+#ifdef __cplusplus
+}
+#endif
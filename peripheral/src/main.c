@@ -9,10 +9,12 @@
 #include <zephyr/types.h>
 #include <stddef.h>
 #include <string.h>
+#include <stdlib.h>
 #include <errno.h>
 #include <zephyr/sys/printk.h>
 #include <zephyr/sys/byteorder.h>
 #include <zephyr/zephyr.h>
+#include <zephyr/logging/log.h>
 
 #include <zephyr/settings/settings.h>
 
@@ -25,18 +27,26 @@
 #include <zephyr/bluetooth/services/hrs.h>
 #include <zephyr/bluetooth/services/ias.h>
 
+#include "broadcast.h"
+#include "clock_follower.h"
 #include "cts.h"
+#include "event_bus.h"
+#include "frame_sink.h"
+#include "key_matrix.h"
+#include "led_engine.h"
+#include "subscription.h"
+#include "conn_profile.h"
+#include "press_record.h"
+#include "vnd_uuid.h"
 #include <zephyr/drivers/gpio.h>
 
+LOG_MODULE_REGISTER(peripheral, CONFIG_PERIPHERAL_LOG_LEVEL);
+
 
 /* Custom Service Variables */
-#define BT_UUID_CUSTOM_SERVICE_KEY \
-	BT_UUID_128_ENCODE(0xDEADBEEF, 0xFEED, 0xBEEF, 0xF1D0, 0xFFFFFFFFFFFF)
 static const struct bt_uuid_128 service_uuid = BT_UUID_INIT_128(BT_UUID_CUSTOM_SERVICE_KEY);
-
-#define BT_UUID_CUSTOM_SERVICE_PRESS \
-	BT_UUID_128_ENCODE(0x12345678, 0x1234, 0x5678, 0x1234, 0xEEEEEEEEEEEE)
 static const struct bt_uuid_128 press_uuid = BT_UUID_INIT_128(BT_UUID_CUSTOM_SERVICE_PRESS);
+static const struct bt_uuid_128 clock_uuid = BT_UUID_INIT_128(BT_UUID_CUSTOM_SERVICE_CLOCK);
 
 static void hrmc_ccc_cfg_changed(const struct bt_gatt_attr *attr, uint16_t value)
 {
@@ -44,10 +54,22 @@ static void hrmc_ccc_cfg_changed(const struct bt_gatt_attr *attr, uint16_t value
 
 	bool notif_enabled = (value == BT_GATT_CCC_NOTIFY);
 
-	printk("KEYPRESS notifications %s", notif_enabled ? "enabled" : "disabled");
+	printk("KEYPRESS notifications %s\n", notif_enabled ? "enabled" : "disabled");
 }
 
 
+/* Lets a central estimate the clock offset behind PRESS timestamps */
+static ssize_t read_clock(struct bt_conn *conn, const struct bt_gatt_attr *attr,
+			  void *buf, uint16_t len, uint16_t offset)
+{
+	uint8_t now[sizeof(uint32_t)];
+
+	sys_put_le32(press_clock_us(k_uptime_ticks()), now);
+
+	return bt_gatt_attr_read(conn, attr, buf, len, offset, now,
+				 sizeof(now));
+}
+
 #define HRS_GATT_PERM_DEFAULT (						\
 	(BT_GATT_PERM_READ | BT_GATT_PERM_WRITE))			\
 	
@@ -58,6 +80,8 @@ BT_GATT_SERVICE_DEFINE(vnd_svc,
 			       BT_GATT_PERM_NONE, NULL, NULL, NULL),
 	BT_GATT_CCC(hrmc_ccc_cfg_changed,
 		    HRS_GATT_PERM_DEFAULT),
+	BT_GATT_CHARACTERISTIC(&clock_uuid.uuid, BT_GATT_CHRC_READ,
+			       BT_GATT_PERM_READ, read_clock, NULL, NULL),
 );
 
 static const struct bt_data ad[] = {
@@ -71,10 +95,12 @@ static const struct bt_data ad[] = {
 
 /* DeviceTree Setup */
 /*
- * Get button configuration from the devicetree sw0 alias. This is mandatory.
+ * Get button configuration from the devicetree sw0 alias. This is mandatory
+ * unless a tree,key-matrix node provides the keys or presses are injected.
  */
 #define SW0_NODE	DT_ALIAS(sw0)
-#if !DT_NODE_HAS_STATUS(SW0_NODE, okay)
+#if !DT_NODE_HAS_STATUS(SW0_NODE, okay) && !defined(CONFIG_PERIPHERAL_KEY_MATRIX) && \
+	CONFIG_PERIPHERAL_PRESS_INJECT_MS == 0
 #error "Unsupported board: sw0 devicetree alias is not defined"
 #endif
 
@@ -109,20 +135,291 @@ void configure_led(struct gpio_dt_spec l) {
 }
 
 static struct gpio_callback button_cb_data;
+
+/* Key edges are timestamped (in ticks) where they are seen and published
+ * on the event bus. press_work subscribes to them and packs them into
+ * PRESS notifications from thread context; led_work mirrors them on LEDs.
+ */
+static void press_work_handler(struct k_work *work);
+static K_WORK_DELAYABLE_DEFINE(press_work, press_work_handler);
+EVENT_SUB_DEFINE(press_sub, BIT(EVENT_CHAN_KEY),
+		 CONFIG_PERIPHERAL_PRESS_QUEUE_SIZE, &press_work);
+
+static void led_work_handler(struct k_work *work);
+static K_WORK_DELAYABLE_DEFINE(led_work, led_work_handler);
+EVENT_SUB_DEFINE(led_sub, BIT(EVENT_CHAN_KEY) | BIT(EVENT_CHAN_CONN) |
+		 BIT(EVENT_CHAN_LED), 8, &led_work);
+
+static struct {
+	uint32_t sent;
+	uint32_t notifications;
+	/* Contact bounce filtered in the ISR */
+	uint32_t bounced;
+	/* Notification failed for a reason other than buffer shortage */
+	uint32_t failed;
+	/* Packed but dropped since no peer was subscribed */
+	uint32_t suppressed;
+	/* Time spent in button_pressed() */
+	uint32_t isr_count;
+	uint64_t isr_cycles;
+	uint32_t isr_max_cycles;
+} press_stats;
+
+/* Largest ATT payload with the default LE Data Length maximum MTU */
+#define PRESS_NOTIFY_MAX 244
+/* ATT_MTU every LE link starts with */
+#define PRESS_DEFAULT_MTU 23
+
+/* Records packed but not yet sent, kept across buffer shortage retries */
+static uint8_t press_buf[PRESS_NOTIFY_MAX];
+static size_t press_buf_len;
+/* Identifies our presses in every PRESS header, set once the identity is
+ * loaded, before anything is advertised.
+ */
+static uint32_t own_origin;
+/* Edge time of each packed record, to restamp a partially sent buffer */
+static int64_t press_buf_ticks[(PRESS_NOTIFY_MAX - PRESS_HEADER_SIZE) /
+			       PRESS_RECORD_SIZE];
+
+#define PRESS_BUF_RECORDS(len) (((len) - PRESS_HEADER_SIZE) / PRESS_RECORD_SIZE)
+
+/* Drops the first len bytes' worth of records; the rest keep their order
+ * and get a header stamped with the new first record's edge.
+ */
+static void press_buf_consume(size_t len)
+{
+	size_t sent = PRESS_BUF_RECORDS(len);
+	size_t left = PRESS_BUF_RECORDS(press_buf_len) - sent;
+
+	if (!left) {
+		press_buf_len = 0;
+		return;
+	}
+
+	memmove(&press_buf[PRESS_HEADER_SIZE], &press_buf[len],
+		left * PRESS_RECORD_SIZE);
+	memmove(&press_buf_ticks[0], &press_buf_ticks[sent],
+		left * sizeof(press_buf_ticks[0]));
+	sys_put_le32(press_clock_us(press_buf_ticks[0]), press_buf);
+	press_buf_len = PRESS_HEADER_SIZE + left * PRESS_RECORD_SIZE;
+}
+
+static void min_mtu(struct bt_conn *conn, void *data)
+{
+	uint16_t *mtu = data;
+
+	*mtu = MIN(*mtu, bt_gatt_get_mtu(conn));
+}
+
+/* Notification payload that every connected peer can take */
+static size_t press_payload_max(void)
+{
+	uint16_t mtu = UINT16_MAX;
+
+	bt_conn_foreach(BT_CONN_TYPE_LE, min_mtu, &mtu);
+	if (mtu == UINT16_MAX || mtu < PRESS_DEFAULT_MTU) {
+		mtu = PRESS_DEFAULT_MTU;
+	}
+
+	/* 3 bytes of ATT opcode and handle */
+	return MIN(mtu - 3, sizeof(press_buf));
+}
+
+static void press_work_handler(struct k_work *work)
+{
+	static uint32_t reported_dropped;
+	static int64_t last_timestamp;
+	const struct event *ev;
+	uint32_t dropped;
+	size_t len;
+	int err;
+
+	if (IS_ENABLED(CONFIG_CONN_PROFILE)) {
+		conn_profile_activity(NULL);
+	}
+
+	do {
+		size_t max = press_payload_max();
+
+		while (MAX(press_buf_len, PRESS_HEADER_SIZE) +
+		       PRESS_RECORD_SIZE <= max &&
+		       (ev = event_bus_get(&press_sub, K_NO_WAIT))) {
+			const struct key_event *evt = &ev->key;
+			int64_t ms = k_ticks_to_ms_floor64(evt->timestamp -
+							   last_timestamp);
+			struct press_record rec = {
+				.seq = evt->seq,
+				.key = evt->key,
+				.down = evt->down,
+				.delta_ms = MIN(ms, UINT16_MAX),
+			};
+
+			if (!press_buf_len) {
+				sys_put_le32(press_clock_us(evt->timestamp),
+					     press_buf);
+				sys_put_le32(own_origin, &press_buf[4]);
+				press_buf_len = PRESS_HEADER_SIZE;
+			}
+
+			last_timestamp = evt->timestamp;
+			press_buf_ticks[PRESS_BUF_RECORDS(press_buf_len)] =
+				evt->timestamp;
+			press_record_encode(&rec, &press_buf[press_buf_len]);
+			press_buf_len += PRESS_RECORD_SIZE;
+
+			event_bus_release(ev);
+		}
+
+		if (!press_buf_len) {
+			break;
+		}
+
+		if (!subscription_any(&vnd_svc.attrs[2])) {
+			press_stats.suppressed += PRESS_BUF_RECORDS(press_buf_len);
+			press_buf_len = 0;
+			continue;
+		}
+
+		/* A peer with a smaller MTU may have connected since the
+		 * records were packed: send what fits, keep the rest.
+		 */
+		len = MIN(press_buf_len, PRESS_HEADER_SIZE +
+			  PRESS_BUF_RECORDS(max) * PRESS_RECORD_SIZE);
+
+		err = bt_gatt_notify(NULL, &vnd_svc.attrs[2], press_buf, len);
+		if (err == -ENOMEM) {
+			/* Out of buffers: keep the records and back off */
+			k_work_schedule(&press_work,
+					K_MSEC(CONFIG_PERIPHERAL_PRESS_RETRY_MS));
+			break;
+		}
+
+		if (err) {
+			press_stats.failed += PRESS_BUF_RECORDS(len);
+			LOG_ERR("Notify 2 Failed, %i", err);
+		} else {
+			press_stats.sent += PRESS_BUF_RECORDS(len);
+			press_stats.notifications++;
+		}
+
+		press_buf_consume(len);
+	} while (press_buf_len || k_msgq_num_used_get(press_sub.queue));
+
+	dropped = press_sub.dropped + event_bus_dropped();
+	if (dropped != reported_dropped) {
+		reported_dropped = dropped;
+		LOG_WRN("Press queue overflowed, %u presses dropped so far",
+			reported_dropped);
+	}
+}
+
+static const struct gpio_dt_spec *const leds[] = { &led_one, &led_two };
+
+static void led_work_handler(struct k_work *work)
+{
+	const struct event *ev;
+
+	while ((ev = event_bus_get(&led_sub, K_NO_WAIT))) {
+		const struct gpio_dt_spec *led = NULL;
+		enum led_op op = LED_OP_TOGGLE;
+		int err = 0;
+
+		switch (ev->chan) {
+		case EVENT_CHAN_KEY:
+			led = ev->key.down ? &led_two : NULL;
+			break;
+		case EVENT_CHAN_CONN:
+			led = ev->conn.connected ? &led_one : NULL;
+			break;
+		case EVENT_CHAN_LED:
+			if (ev->led.led < ARRAY_SIZE(leds)) {
+				led = leds[ev->led.led];
+				op = ev->led.op;
+			}
+			break;
+		default:
+			break;
+		}
+
+		/* Boards without the LED aliases, such as simulated ones */
+		if (led && !led->port) {
+			led = NULL;
+		}
+
+		if (led && op == LED_OP_TOGGLE) {
+			err = gpio_pin_toggle_dt(led);
+		} else if (led) {
+			err = gpio_pin_set_dt(led, op == LED_OP_ON);
+		}
+
+		if (err) {
+			LOG_ERR("LED Toggle failed (err 0x%02x)", err);
+		}
+
+		event_bus_release(ev);
+	}
+}
+
+/* Publish one key edge; safe from ISRs and threads */
+static void press_publish(uint8_t key, bool down, int64_t timestamp)
+{
+	static atomic_t seq;
+	struct key_event evt = {
+		.timestamp = timestamp,
+		.source = KEY_SOURCE_NONE,
+		.key = key,
+		.down = down,
+	};
+
+	/* Dropped presses still use up a sequence number so the
+	 * central sees the gap.
+	 */
+	evt.seq = (uint16_t)atomic_inc(&seq);
+	(void)event_bus_publish_key(&evt);
+}
+
 void button_pressed(const struct device *dev, struct gpio_callback *cb,
 		    uint32_t pins)
 {
-	int err;
-	printk("Button pressed at %" PRIu32 "\n", k_cycle_get_32());
-	gpio_pin_toggle_dt(&led_two);
+	static int64_t last_press;
+	uint32_t entry = k_cycle_get_32();
+	int64_t now = k_uptime_ticks();
 
-	static uint8_t hrm2[2] = {0x06, 0x02}; // random data for now
-	err = bt_gatt_notify(NULL, &vnd_svc.attrs[2], &hrm2, sizeof(hrm2));
-	if (err) {
-		printk("Notify 2 Failed, %i\n", err);
+	if (now - last_press <
+	    k_ms_to_ticks_ceil64(CONFIG_PERIPHERAL_PRESS_DEBOUNCE_MS)) {
+		press_stats.bounced++;
+		return;
 	}
+	last_press = now;
+
+	press_publish(0, true, now);
+
+	if (IS_ENABLED(CONFIG_PERIPHERAL_HOT_PATH_STATS)) {
+		uint32_t cycles = k_cycle_get_32() - entry;
+
+		press_stats.isr_count++;
+		press_stats.isr_cycles += cycles;
+		press_stats.isr_max_cycles = MAX(press_stats.isr_max_cycles,
+						 cycles);
+	}
+}
+
+static void matrix_key_changed(uint8_t key, bool down, int64_t timestamp)
+{
+	press_publish(key, down, timestamp);
 }
 
+/* Stands in for a button on boards without one, from ISR context too */
+static void inject_expired(struct k_timer *timer)
+{
+	static bool down;
+
+	down = !down;
+	press_publish(0, down, k_uptime_ticks());
+}
+
+static K_TIMER_DEFINE(inject_timer, inject_expired, NULL);
+
 void configure_button(struct gpio_dt_spec button) {
 	if (!device_is_ready(button.port)) {
 		printk("Error: button device %s is not ready\n",
@@ -152,29 +449,89 @@ void configure_button(struct gpio_dt_spec button) {
 
 void mtu_updated(struct bt_conn *conn, uint16_t tx, uint16_t rx)
 {
-	printk("Updated MTU: TX: %d RX: %d bytes\n", tx, rx);
+	printk("Updated MTU: TX: %d RX: %d bytes, %zu press records per notification\n",
+	       tx, rx, (press_payload_max() - PRESS_HEADER_SIZE) / PRESS_RECORD_SIZE);
 }
 
 static struct bt_gatt_cb gatt_callbacks = {
 	.att_mtu_updated = mtu_updated
 };
 
+/* Start-up phases, in the order they complete */
+enum boot_phase {
+	BOOT_KERNEL,
+	BOOT_BT,
+	BOOT_BONDS,
+	BOOT_ADV,
+	BOOT_SETTINGS,
+	BOOT_PHASES,
+};
+
+/* Microseconds of uptime at the end of each phase. The system clock
+ * starts just after reset, so these are close to times since reset.
+ */
+static uint32_t boot_us[BOOT_PHASES];
+
+static void boot_mark(enum boot_phase phase)
+{
+	if (!boot_us[phase]) {
+		boot_us[phase] = k_ticks_to_us_floor32(k_uptime_ticks());
+	}
+}
+
+static atomic_t conn_count;
+static void adv_work_handler(struct k_work *work);
+static K_WORK_DEFINE(adv_work, adv_work_handler);
+static void sim_start(void);
+static void sim_stop(void);
+static void notify_stats_print(void);
+
+/* Set once high duty directed advertising went unanswered, so we fall
+ * back to undirected advertising until the next connection.
+ */
+static bool directed_timed_out;
+static int64_t disconnected_at;
+
 static void connected(struct bt_conn *conn, uint8_t err)
 {
-	if (err) {
+	if (err == BT_HCI_ERR_ADV_TIMEOUT) {
+		printk("Bonded central did not answer directed advertising\n");
+		directed_timed_out = true;
+		k_work_submit(&adv_work);
+	} else if (err) {
 		printk("Connection failed (err 0x%02x)\n", err);
 	} else {
-		int err = gpio_pin_toggle_dt(&led_one);
-		if (err) {
-			printk("LED Toggle failed (err 0x%02x)\n", err);
+		directed_timed_out = false;
+		if (disconnected_at) {
+			printk("Reconnected %u ms after disconnect\n",
+			       (uint32_t)(k_uptime_get() - disconnected_at));
+			disconnected_at = 0;
 		}
+
+		(void)event_bus_publish_conn(bt_conn_index(conn), true, 0);
 		printk("Connected\n");
+
+		if (atomic_inc(&conn_count) == 0) {
+			sim_start();
+		}
 	}
 }
 
 static void disconnected(struct bt_conn *conn, uint8_t reason)
 {
 	printk("Disconnected (reason 0x%02x)\n", reason);
+
+	(void)event_bus_publish_conn(bt_conn_index(conn), false, reason);
+	disconnected_at = k_uptime_get();
+
+	if (atomic_dec(&conn_count) == 1) {
+		sim_stop();
+	}
+
+	notify_stats_print();
+
+	/* The connection is only released after this callback returns */
+	k_work_submit(&adv_work);
 }
 
 static void alert_stop(void)
@@ -203,16 +560,40 @@ BT_IAS_CB_DEFINE(ias_callbacks) = {
 	.high_alert = alert_high_start,
 };
 
-static void bt_ready(void)
+static void bond_first(const struct bt_bond_info *info, void *user_data)
 {
-	int err;
+	bt_addr_le_t *peer = user_data;
 
-	printk("Bluetooth initialized\n");
+	if (!bt_addr_le_cmp(peer, BT_ADDR_LE_ANY)) {
+		bt_addr_le_copy(peer, &info->addr);
+	}
+}
 
-	cts_init();
+/* A bonded central gets 1.28 s of high duty directed advertising, which
+ * it can answer on the first packet it hears; everyone else waits for
+ * the regular undirected advertising.
+ */
+static void advertise(void)
+{
+	bt_addr_le_t peer;
+	char addr[BT_ADDR_LE_STR_LEN];
+	int err;
 
-	if (IS_ENABLED(CONFIG_SETTINGS)) {
-		settings_load();
+	bt_addr_le_copy(&peer, BT_ADDR_LE_ANY);
+	if (IS_ENABLED(CONFIG_PERIPHERAL_DIRECTED_ADV) && !directed_timed_out) {
+		bt_foreach_bond(BT_ID_DEFAULT, bond_first, &peer);
+	}
+
+	if (bt_addr_le_cmp(&peer, BT_ADDR_LE_ANY)) {
+		err = bt_le_adv_start(BT_LE_ADV_CONN_DIR(&peer), NULL, 0,
+				      NULL, 0);
+		if (!err) {
+			boot_mark(BOOT_ADV);
+			bt_addr_le_to_str(&peer, addr, sizeof(addr));
+			printk("Directed advertising to %s\n", addr);
+			return;
+		}
+		printk("Directed advertising failed (err %d)\n", err);
 	}
 
 	err = bt_le_adv_start(BT_LE_ADV_CONN_NAME, ad, ARRAY_SIZE(ad), NULL, 0);
@@ -221,16 +602,118 @@ static void bt_ready(void)
 		return;
 	}
 
-	err = gpio_pin_toggle_dt(&led_two);
+	boot_mark(BOOT_ADV);
+	printk("Advertising successfully started\n");
+}
+
+static void adv_work_handler(struct k_work *work)
+{
+	/* Undirected advertising resumes on its own after a disconnect */
+	(void)bt_le_adv_stop();
+	advertise();
+}
+
+#if defined(CONFIG_SETTINGS)
+/* Everything bt_ready() left out: the Bluetooth subtree is loaded already */
+static int settings_load_rest(const char *key, size_t len,
+			      settings_read_cb read_cb, void *cb_arg,
+			      void *param)
+{
+	if (settings_name_steq(key, "bt", NULL)) {
+		return 0;
+	}
+
+	return settings_call_set_handler(key, len, read_cb, cb_arg, NULL);
+}
+#endif
+
+static void settings_work_handler(struct k_work *work)
+{
+#if defined(CONFIG_SETTINGS)
+	int err = settings_load_subtree_direct(NULL, settings_load_rest, NULL);
+
 	if (err) {
-		printk("LED Toggle failed (err 0x%02x)\n", err);
+		printk("Settings failed to load (err %d)\n", err);
 	}
-	printk("Advertising successfully started\n");
+	/* Committing "bt" a second time changes nothing once it is ready */
+	(void)settings_commit();
+#endif
+
+	boot_mark(BOOT_SETTINGS);
+	printk("[BOOT] kernel %u us, bt %u us, bonds %u us, adv %u us, "
+	       "settings %u us\n", boot_us[BOOT_KERNEL], boot_us[BOOT_BT],
+	       boot_us[BOOT_BONDS], boot_us[BOOT_ADV], boot_us[BOOT_SETTINGS]);
+}
+
+static K_WORK_DEFINE(settings_work, settings_work_handler);
+
+/* Runs on the system workqueue as soon as the controller is up, while
+ * main() may still be setting up the inputs.
+ */
+static void bt_ready(int err)
+{
+	struct bt_gatt_attr *vnd_ind_attr;
+	char str[BT_UUID_STR_LEN];
+	bt_addr_le_t id_addr;
+	size_t id_count = 1;
+
+	if (err) {
+		printk("Bluetooth init failed (err %d)\n", err);
+		return;
+	}
+
+	boot_mark(BOOT_BT);
+	printk("Bluetooth initialized\n");
+
+	cts_init();
+
+	if (IS_ENABLED(CONFIG_LED_UPLOAD)) {
+		err = frame_sink_init();
+		if (err) {
+			printk("Frame channel failed to register (err %d)\n", err);
+		}
+	}
+
+	/* The identity and the bonds are all advertising needs; they also
+	 * finish the stack's initialisation, so nothing else is read first.
+	 */
+	if (IS_ENABLED(CONFIG_SETTINGS)) {
+		settings_load_subtree("bt");
+	}
+	boot_mark(BOOT_BONDS);
+
+	/* The identity address, not the one on air: with privacy the
+	 * latter changes, and relays must agree on who a press is from.
+	 */
+	bt_id_get(&id_addr, &id_count);
+	own_origin = press_origin(&id_addr);
+
+	if (IS_ENABLED(CONFIG_PERIPHERAL_BROADCAST)) {
+		err = broadcast_start(own_origin);
+		if (err) {
+			printk("Broadcast failed to start (err %d)\n", err);
+		}
+	}
+
+	advertise();
+
+	k_work_submit(&settings_work);
+
+	(void)event_bus_publish_led(1, LED_OP_TOGGLE);
+
+	vnd_ind_attr = bt_gatt_find_by_uuid(vnd_svc.attrs, vnd_svc.attr_count,
+					    &press_uuid.uuid);
+	bt_uuid_to_str(&press_uuid.uuid, str, sizeof(str));
+	printk("Indicate VND attr %p (UUID %s) (handle %d)\n", vnd_ind_attr, str,
+	       vnd_ind_attr->handle);
 }
 
-static void bas_notify(void)
+/* The simulations below return true when a notification went out */
+
+static bool bas_notify(bool subscribed)
 {
-	uint8_t battery_level = bt_bas_get_battery_level();
+	static uint8_t battery_level = 100U;
+	uint8_t reported = bt_bas_get_battery_level();
 
 	battery_level--;
 
@@ -238,10 +721,22 @@ static void bas_notify(void)
 		battery_level = 100U;
 	}
 
+	/* Publish only meaningful changes: a full step, or crossing into
+	 * or out of the low battery range.
+	 */
+	if (abs(battery_level - reported) < CONFIG_PERIPHERAL_BAS_REPORT_STEP &&
+	    (battery_level <= CONFIG_PERIPHERAL_BAS_LOW_LEVEL) ==
+	    (reported <= CONFIG_PERIPHERAL_BAS_LOW_LEVEL)) {
+		return false;
+	}
+
+	/* Also updates the readable value, so it runs even unsubscribed */
 	bt_bas_set_battery_level(battery_level);
+
+	return subscribed;
 }
 
-static void hrs_notify(void)
+static bool hrs_notify(bool subscribed)
 {
 	static uint8_t heartrate = 90U;
 
@@ -251,50 +746,175 @@ static void hrs_notify(void)
 		heartrate = 90U;
 	}
 
-	bt_hrs_notify(heartrate);
+	return subscribed && !bt_hrs_notify(heartrate);
+}
+
+/* Simulated measurements, each on its own period. They only run while a
+ * central is connected so that an advertising-only device stays idle.
+ */
+struct sim_notifier {
+	const char *name;
+	struct k_work_delayable work;
+	uint32_t period_ms;
+	bool (*notify)(bool subscribed);
+	const struct bt_uuid *uuid;
+	const struct bt_gatt_attr *attr;
+	uint32_t runs;
+	struct notify_count count;
+};
+
+static struct sim_notifier sim_notifiers[] = {
+	{
+		.name = "hrs",
+		.period_ms = CONFIG_PERIPHERAL_HRS_PERIOD_MS,
+		.notify = hrs_notify,
+		.uuid = BT_UUID_HRS_MEASUREMENT,
+	},
+	{
+		.name = "bas",
+		.period_ms = CONFIG_PERIPHERAL_BAS_PERIOD_MS,
+		.notify = bas_notify,
+		.uuid = BT_UUID_BAS_BATTERY_LEVEL,
+	},
+};
+
+static void sim_work_handler(struct k_work *work)
+{
+	struct sim_notifier *sim = CONTAINER_OF(k_work_delayable_from_work(work),
+						struct sim_notifier, work);
+
+	if (sim->notify(subscription_any(sim->attr))) {
+		sim->count.sent++;
+	} else {
+		sim->count.suppressed++;
+	}
+	sim->runs++;
+
+	if (atomic_get(&conn_count)) {
+		k_work_schedule(&sim->work, K_MSEC(sim->period_ms));
+	}
+}
+
+static void sim_start(void)
+{
+	for (size_t i = 0; i < ARRAY_SIZE(sim_notifiers); i++) {
+		k_work_schedule(&sim_notifiers[i].work,
+				K_MSEC(sim_notifiers[i].period_ms));
+	}
+}
+
+static void sim_stop(void)
+{
+	for (size_t i = 0; i < ARRAY_SIZE(sim_notifiers); i++) {
+		k_work_cancel_delayable(&sim_notifiers[i].work);
+	}
+}
+
+static void notify_stats_print(void)
+{
+	const struct notify_count *cts = cts_notify_count();
+
+	printk("[NOTIFY] sent/suppressed: press %u/%u", press_stats.sent,
+	       press_stats.suppressed);
+	for (size_t i = 0; i < ARRAY_SIZE(sim_notifiers); i++) {
+		printk(", %s %u/%u", sim_notifiers[i].name,
+		       sim_notifiers[i].count.sent,
+		       sim_notifiers[i].count.suppressed);
+	}
+	printk(", cts %u/%u\n", cts->sent, cts->suppressed);
+
+	if (IS_ENABLED(CONFIG_PERIPHERAL_HOT_PATH_STATS) &&
+	    press_stats.isr_count) {
+		printk("[ISR] button_pressed avg %u us max %u us over %u presses\n",
+		       k_cyc_to_us_floor32(press_stats.isr_cycles /
+					   press_stats.isr_count),
+		       k_cyc_to_us_floor32(press_stats.isr_max_cycles),
+		       press_stats.isr_count);
+	}
+}
+
+#if defined(CONFIG_PERIPHERAL_WAKEUP_STATS)
+static void wakeup_stats_handler(struct k_work *work);
+static K_WORK_DELAYABLE_DEFINE(wakeup_stats_work, wakeup_stats_handler);
+
+/* Work item runs per minute, plus the CPU cycles spent outside idle */
+static void wakeup_stats_handler(struct k_work *work)
+{
+	static uint32_t last_runs;
+	static uint64_t last_cycles;
+	k_thread_runtime_stats_t rt;
+	uint32_t runs = press_stats.notifications;
+
+	for (size_t i = 0; i < ARRAY_SIZE(sim_notifiers); i++) {
+		runs += sim_notifiers[i].runs;
+	}
+
+	if (!k_thread_runtime_stats_all_get(&rt)) {
+		/* total_cycles leaves out the idle thread */
+		printk("[WAKEUPS] %u work item runs, %llu cycles executed in "
+		       "the last minute\n", runs - last_runs,
+		       (unsigned long long)(rt.total_cycles - last_cycles));
+		last_cycles = rt.total_cycles;
+	}
+	last_runs = runs;
+
+	notify_stats_print();
+
+	k_work_schedule(&wakeup_stats_work, K_MINUTES(1));
 }
+#endif /* CONFIG_PERIPHERAL_WAKEUP_STATS */
 
 void main(void)
 {
-	struct bt_gatt_attr *vnd_ind_attr;
-	char str[BT_UUID_STR_LEN];
 	int err;
 
-	configure_button(_button);
+	boot_mark(BOOT_KERNEL);
+
+	for (size_t i = 0; i < ARRAY_SIZE(sim_notifiers); i++) {
+		k_work_init_delayable(&sim_notifiers[i].work, sim_work_handler);
+		sim_notifiers[i].attr = bt_gatt_find_by_uuid(NULL, 0,
+							     sim_notifiers[i].uuid);
+	}
+
+	event_bus_subscribe(&press_sub);
+	event_bus_subscribe(&led_sub);
 	configure_led(led_one);
 	configure_led(led_two);
+	bt_gatt_cb_register(&gatt_callbacks);
 
-	err = bt_enable(NULL);
+	/* Bring up the controller first and set up the inputs meanwhile;
+	 * bt_ready() starts advertising without waiting for them.
+	 */
+	err = bt_enable(bt_ready);
 	if (err) {
 		printk("Bluetooth init failed (err %d)\n", err);
 		return;
 	}
 
-	bt_ready();
+	if (IS_ENABLED(CONFIG_PERIPHERAL_KEY_MATRIX)) {
+		key_matrix_init(matrix_key_changed);
+	} else if (_button.port) {
+		configure_button(_button);
+	}
 
-	bt_gatt_cb_register(&gatt_callbacks);
+	if (CONFIG_PERIPHERAL_PRESS_INJECT_MS) {
+		k_timer_start(&inject_timer, K_MSEC(CONFIG_PERIPHERAL_PRESS_INJECT_MS),
+			      K_MSEC(CONFIG_PERIPHERAL_PRESS_INJECT_MS));
+	}
 
-	 vnd_ind_attr = bt_gatt_find_by_uuid(vnd_svc.attrs, vnd_svc.attr_count,
-	 				    &press_uuid.uuid);
-	 bt_uuid_to_str(&press_uuid.uuid, str, sizeof(str));
-	 printk("Indicate VND attr %p (UUID %s) (handle %d)\n", vnd_ind_attr, str, vnd_ind_attr->handle);
+#if defined(CONFIG_LED_ENGINE)
+	/* Effects follow the central's clock so all nodes stay in phase */
+	led_engine_set_clock(clock_follower_now_ms);
+	err = led_engine_start(DEVICE_DT_GET(DT_ALIAS(led_strip)),
+			       DT_PROP(DT_ALIAS(led_strip), chain_length));
 	if (err) {
-		printk("service regi fail (err %d)\n", err);
-		return;
+		printk("LED strip failed to start (err %d)\n", err);
 	}
-	/* Implement notification. At the moment there is no suitable way
-	 * of starting delayed work so we do it here
-	 */
-	while (1) {
-		k_sleep(K_SECONDS(1));
-
-		/* Current Time Service updates only when time is changed */
-		cts_notify();
+#endif
 
-		/* Heartrate measurements simulation */
-		hrs_notify();
+#if defined(CONFIG_PERIPHERAL_WAKEUP_STATS)
+	k_work_schedule(&wakeup_stats_work, K_MINUTES(1));
+#endif
 
-		/* Battery level simulation */
-		bas_notify();
-	}
+	/* Nothing left to poll: notifications are driven by work items */
 }
@@ -0,0 +1,120 @@
+/** @file
+ *  @brief Settings backend in RAM
+ *
+ *  Boards without flash, such as nrf52_bsim, still run the settings
+ *  subsystem through this store, so the split identity and bonds load in
+ *  bt_ready() and the later full load take the same path as on hardware.
+ *  Nothing survives a reset, so the store is always empty at boot and the
+ *  split load finds no bonds to restore.
+ */
+
+/*
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <zephyr/types.h>
+#include <stddef.h>
+#include <string.h>
+#include <errno.h>
+#include <zephyr/zephyr.h>
+#include <zephyr/settings/settings.h>
+
+#define RAM_ENTRIES 32
+
+struct ram_entry {
+	char name[SETTINGS_MAX_NAME_LEN + 1];
+	uint8_t value[SETTINGS_MAX_VAL_LEN];
+	size_t len;
+};
+
+static struct ram_entry entries[RAM_ENTRIES];
+
+/* The settings lock is held around every load and save */
+static struct ram_entry *entry_find(const char *name)
+{
+	for (size_t i = 0; i < ARRAY_SIZE(entries); i++) {
+		if (!strcmp(entries[i].name, name)) {
+			return &entries[i];
+		}
+	}
+
+	return NULL;
+}
+
+static ssize_t ram_read(void *cb_arg, void *data, size_t len)
+{
+	const struct ram_entry *entry = cb_arg;
+
+	len = MIN(len, entry->len);
+	memcpy(data, entry->value, len);
+
+	return len;
+}
+
+static int ram_load(struct settings_store *cs,
+		    const struct settings_load_arg *arg)
+{
+	for (size_t i = 0; i < ARRAY_SIZE(entries); i++) {
+		struct ram_entry *entry = &entries[i];
+
+		if (!entry->name[0]) {
+			continue;
+		}
+
+		/* Skips names outside arg's subtree */
+		(void)settings_call_set_handler(entry->name, entry->len,
+						ram_read, entry, arg);
+	}
+
+	return 0;
+}
+
+static int ram_save(struct settings_store *cs, const char *name,
+		    const char *value, size_t val_len)
+{
+	struct ram_entry *entry = entry_find(name);
+
+	if (strlen(name) >= sizeof(entries[0].name) ||
+	    val_len > sizeof(entries[0].value)) {
+		return -EINVAL;
+	}
+
+	/* No value deletes the entry */
+	if (!value || !val_len) {
+		if (entry) {
+			entry->name[0] = '\0';
+		}
+		return 0;
+	}
+
+	if (!entry) {
+		entry = entry_find("");
+		if (!entry) {
+			return -ENOMEM;
+		}
+		strcpy(entry->name, name);
+	}
+
+	memcpy(entry->value, value, val_len);
+	entry->len = val_len;
+
+	return 0;
+}
+
+static const struct settings_store_itf ram_itf = {
+	.csi_load = ram_load,
+	.csi_save = ram_save,
+};
+
+static struct settings_store ram_store = {
+	.cs_itf = &ram_itf,
+};
+
+/* Called by settings_subsys_init() for CONFIG_SETTINGS_CUSTOM */
+int settings_backend_init(void)
+{
+	settings_src_register(&ram_store);
+	settings_dst_register(&ram_store);
+
+	return 0;
+}
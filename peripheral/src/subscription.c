@@ -0,0 +1,50 @@
+/** @file
+ *  @brief Notification subscription checks
+ *
+ *  The host keeps each peer's CCC value, so asking it per connection is
+ *  enough; no copy of the CCC state is kept here.
+ */
+
+/*
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <zephyr/types.h>
+#include <stddef.h>
+#include <zephyr/zephyr.h>
+
+#include <zephyr/bluetooth/bluetooth.h>
+#include <zephyr/bluetooth/conn.h>
+#include <zephyr/bluetooth/gatt.h>
+
+#include "subscription.h"
+
+struct subscription_query {
+	const struct bt_gatt_attr *attr;
+	bool found;
+};
+
+static void check_conn(struct bt_conn *conn, void *data)
+{
+	struct subscription_query *query = data;
+
+	if (!query->found &&
+	    bt_gatt_is_subscribed(conn, query->attr, BT_GATT_CCC_NOTIFY)) {
+		query->found = true;
+	}
+}
+
+bool subscription_any(const struct bt_gatt_attr *attr)
+{
+	struct subscription_query query = {
+		.attr = attr,
+	};
+
+	if (!attr) {
+		return false;
+	}
+
+	bt_conn_foreach(BT_CONN_TYPE_LE, check_conn, &query);
+
+	return query.found;
+}
@@ -0,0 +1,30 @@
+/** @file
+ *  @brief Notification subscription checks
+ */
+
+/*
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <zephyr/bluetooth/gatt.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Notifications of one characteristic that went out, or were skipped
+ * because nobody listened or the value did not change.
+ */
+struct notify_count {
+	uint32_t sent;
+	uint32_t suppressed;
+};
+
+/* True when at least one connected peer has enabled notifications for
+ * the characteristic declared or valued by attr.
+ */
+bool subscription_any(const struct bt_gatt_attr *attr);
+
+#ifdef __cplusplus
+}
+#endif
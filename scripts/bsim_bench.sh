@@ -0,0 +1,273 @@
+#!/usr/bin/env bash
+# SPDX-License-Identifier: Apache-2.0
+#
+# Build central and peripheral for nrf52_bsim, run them against the
+# BabbleSim 2.4 GHz phy and write the central's BENCH reports as JSON
+# lines. The peripherals' start-up times are printed at the end.
+# Headless, so it can run per commit on any Linux box.
+#
+# Needs ZEPHYR_BASE, BSIM_OUT_PATH and BSIM_COMPONENTS_PATH set up as for
+# Zephyr's own BabbleSim tests, and west on the PATH.
+#
+#   scripts/bsim_bench.sh [scenario] [output.jsonl]
+#
+# Scenarios:
+#
+#   pair       one central and one peripheral (the default)
+#   multilink  one central and PERIPHERALS peripherals (default 4, the
+#              central's CONFIG_BT_MAX_CONN); fails unless every link
+#              delivered presses during the last report interval
+#   latency    pair with the central's full latency histogram; fails
+#              without samples or with p99 above LATENCY_P99_MAX_US
+#   broadcast  a broadcasting peripheral, one central connected to it
+#              and one listening to its periodic advertising; the
+#              listener's reports go to <output>-listener.jsonl
+#   relay      two hub centrals, a relay node and a peripheral only the
+#              relay can hear; fails unless the relay took exactly one
+#              upstream hub and presses reached it through the relay
+#              only. The second hub's reports go to <output>-hub2.jsonl
+#
+# SIM_SECONDS (default 60) sets the simulated run time.
+
+set -eu
+
+: "${ZEPHYR_BASE:?}" "${BSIM_OUT_PATH:?}" "${BSIM_COMPONENTS_PATH:?}"
+
+ROOT=$(cd "$(dirname "$0")/.." && pwd)
+SCENARIO=${1:-pair}
+OUT=${2:-bench.jsonl}
+SIM_SECONDS=${SIM_SECONDS:-60}
+SIM_ID=tree_bench_$$
+BUILD=${BUILD_DIR:-$ROOT/build/bsim}
+BIN=$BSIM_OUT_PATH/bin
+pids=""
+
+# build <app> <image> [overlay.conf ...]
+#
+# Builds app with the given overlays on top of prj.conf and the board's
+# nrf52_bsim.conf, and stages it in the BabbleSim bin directory.
+build() {
+	app=$1
+	image=$2
+	shift 2
+	overlays=$(IFS=';'; echo "$*")
+
+	west build -b nrf52_bsim -d "$BUILD/$image" -p auto "$ROOT/$app" -- \
+		-DOVERLAY_CONFIG="$overlays"
+	cp "$BUILD/$image/zephyr/zephyr.exe" "$BIN/${SIM_ID}_$image.exe"
+}
+
+# start <image> <device> <log>
+start() {
+	./"${SIM_ID}_$1.exe" -s="$SIM_ID" -d="$2" -rs=$(($2 + 1)) \
+		> "$BUILD/$3.log" &
+	pids="$pids $!"
+}
+
+# phy <devices> [channel arguments ...]
+#
+# Runs the phy for SIM_SECONDS and waits for every device to exit.
+phy() {
+	devices=$1
+	shift
+
+	./bs_2G4_phy_v1 -s="$SIM_ID" -D="$devices" \
+		-sim_length=$((SIM_SECONDS * 1000000)) "$@" > "$BUILD/phy.log"
+
+	# shellcheck disable=SC2086
+	wait $pids || true
+}
+
+# bench_extract <log> [output]: the BENCH objects of a central's log,
+# into output (OUT by default)
+bench_extract() {
+	out=${2:-$OUT}
+
+	sed -n 's/^.*BENCH //p' "$BUILD/$1.log" > "$out"
+
+	if [ ! -s "$out" ]; then
+		echo "No BENCH reports, see $BUILD/$1.log" >&2
+		exit 1
+	fi
+
+	# The last report covers the whole run
+	tail -n 1 "$out"
+}
+
+# links_check <count>: every one of count links delivered presses
+# between the last two reports
+links_check() {
+	python3 - "$OUT" "$1" <<'EOF'
+import json
+import sys
+
+reports = [json.loads(line) for line in open(sys.argv[1])]
+want = int(sys.argv[2])
+if len(reports) < 2:
+    sys.exit("Need two BENCH reports, run for longer")
+
+before = {l["link"]: l["presses"] for l in reports[-2]["links"]}
+busy = [l for l in reports[-1]["links"]
+        if l["presses"] > before.get(l["link"], l["presses"])]
+
+print(f"{len(busy)} of {want} links delivered presses in the last interval")
+sys.exit(0 if len(busy) >= want else 1)
+EOF
+}
+
+# latency_check <log>: print the last histogram of a central built with
+# overlay-latency.conf and check the last report's percentiles
+latency_check() {
+	awk '/\[LATENCY\]/ { block = "" }
+	     /\[LATENCY\]|[<>]=? +[0-9]+ us: [0-9]+$/ { block = block $0 "\n" }
+	     END { printf "%s", block }' "$BUILD/$1.log"
+
+	python3 - "$OUT" "${LATENCY_P99_MAX_US:-0}" <<'EOF'
+import json
+import sys
+
+latency = json.loads(open(sys.argv[1]).readlines()[-1])["latency_us"]
+limit = int(sys.argv[2])
+if not latency["count"]:
+    sys.exit("No latency samples")
+if limit and latency["p99"] > limit:
+    sys.exit(f"p99 {latency['p99']} us above {limit} us")
+EOF
+}
+
+# broadcast_compare <connected.jsonl> <listener.jsonl>: presses and
+# latency of both paths side by side
+broadcast_compare() {
+	python3 - "$1" "$2" <<'EOF'
+import json
+import sys
+
+connected, listener = (json.loads(open(f).readlines()[-1])
+                       for f in sys.argv[1:3])
+presses = sum(l["presses"] for l in connected["links"])
+
+print(f"connected: {presses} presses, latency {connected['latency_us']}")
+# Relative to the fastest delivery on the train, not absolute
+print(f"listener:  latency above fastest {listener['latency_us']}")
+if not presses or not listener["latency_us"]["count"]:
+    sys.exit("A path delivered no presses")
+EOF
+}
+
+# relay_check <hub.jsonl> <hub2.jsonl> <relay log>: one hub, and only
+# one, got the peripheral's presses, all of them on RELAY, and the relay
+# kept a single upstream link
+relay_check() {
+	upstreams=$(grep -c '\[RELAY\] upstream connected' "$BUILD/$3.log" ||
+		true)
+	echo "relay: $upstreams upstream connections"
+	if [ "$upstreams" -ne 1 ]; then
+		exit 1
+	fi
+
+	python3 - "$1" "$2" <<'EOF'
+import json
+import sys
+
+hubs = []
+for name in sys.argv[1:3]:
+    lines = open(name).readlines()
+    links = json.loads(lines[-1])["links"] if lines else []
+    hubs.append((sum(l["relayed"] for l in links),
+                 sum(l["presses"] for l in links)))
+
+for i, (relayed, direct) in enumerate(hubs, 1):
+    print(f"hub {i}: {relayed} presses relayed, {direct} direct")
+
+fed = [h for h in hubs if h[0]]
+sys.exit(0 if len(fed) == 1 and not any(h[1] for h in hubs) else 1)
+EOF
+}
+
+mkdir -p "$BUILD"
+
+case $SCENARIO in
+pair)
+	build central central
+	build peripheral peripheral
+	;;
+multilink)
+	PERIPHERALS=${PERIPHERALS:-4}
+	build central central
+	build peripheral peripheral
+	;;
+latency)
+	build central central overlay-latency.conf
+	build peripheral peripheral
+	;;
+broadcast)
+	build central central
+	build central listener overlay-listener.conf
+	build peripheral peripheral overlay-broadcast.conf
+	;;
+relay)
+	build central central
+	build central relay overlay-relay.conf
+	build peripheral peripheral
+	;;
+*)
+	echo "Unknown scenario $SCENARIO" >&2
+	exit 2
+	;;
+esac
+
+cd "$BIN"
+trap 'rm -f ${SIM_ID}_*.exe' EXIT
+
+case $SCENARIO in
+pair)
+	start central 0 central
+	start peripheral 1 peripheral_1
+	phy 2
+	bench_extract central
+	;;
+multilink)
+	start central 0 central
+	for i in $(seq 1 "$PERIPHERALS"); do
+		start peripheral "$i" "peripheral_$i"
+	done
+	phy $((PERIPHERALS + 1))
+	bench_extract central
+	links_check "$PERIPHERALS"
+	;;
+latency)
+	start central 0 central
+	start peripheral 1 peripheral_1
+	phy 2
+	bench_extract central
+	latency_check central
+	;;
+broadcast)
+	start central 0 central
+	start listener 1 listener
+	start peripheral 2 peripheral_2
+	phy 3
+	bench_extract central
+	bench_extract listener "${OUT%.jsonl}-listener.jsonl"
+	broadcast_compare "$OUT" "${OUT%.jsonl}-listener.jsonl"
+	;;
+relay)
+	# Both hubs out of range of the peripheral, both ways
+	printf '0 2 : 120\n2 0 : 120\n3 2 : 120\n2 3 : 120\n' \
+		> "$BUILD/relay.att"
+	start central 0 central
+	start relay 1 relay
+	start peripheral 2 peripheral_2
+	start central 3 central_2
+	phy 4 -channel=multiatt -argschannel -at=60 -file="$BUILD/relay.att"
+	bench_extract central
+	# The hub that lost the race may have no report with a link
+	sed -n 's/^.*BENCH //p' "$BUILD/central_2.log" \
+		> "${OUT%.jsonl}-hub2.jsonl"
+	relay_check "$OUT" "${OUT%.jsonl}-hub2.jsonl" relay
+	;;
+esac
+
+# Start-up phases of each peripheral, the adv time being boot to first
+# advertisement
+grep -h '\[BOOT\]' "$BUILD"/peripheral_*.log || true
@@ -0,0 +1,189 @@
+/*
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <zephyr/types.h>
+#include <stddef.h>
+#include <string.h>
+#include <time.h>
+#include <zephyr/zephyr.h>
+#include <zephyr/ztest.h>
+#include <zephyr/sys/printk.h>
+#include <zephyr/bluetooth/bluetooth.h>
+#include <zephyr/bluetooth/uuid.h>
+
+#include "ad_filter.h"
+
+#define TARGET BT_UUID_128_ENCODE(0xDEADBEEF, 0xFEED, 0xBEEF, 0xF1D0, 0xFFFFFFFFFFFF)
+#define OTHER BT_UUID_128_ENCODE(0x12345678, 0x1234, 0x5678, 0x1234, 0x56789ABCDEF0)
+
+static const uint8_t target[] = { TARGET };
+
+#define FLAGS 0x02, BT_DATA_FLAGS, BT_LE_AD_GENERAL | BT_LE_AD_NO_BREDR
+#define NAME 0x05, BT_DATA_NAME_COMPLETE, 'T', 'r', 'e', 'e'
+#define UUID16 0x03, BT_DATA_UUID16_ALL, 0x0d, 0x18
+
+static bool check(const uint8_t *data, size_t len)
+{
+	struct net_buf_simple ad = {
+		.data = (uint8_t *)data,
+		.len = len,
+		.size = len,
+		.__buf = (uint8_t *)data,
+	};
+
+	return ad_has_target(&ad, target);
+}
+
+#define CHECK(...) ({						\
+	static const uint8_t _ad[] = { __VA_ARGS__ };		\
+	check(_ad, sizeof(_ad));				\
+})
+
+ZTEST(ad_filter, test_complete_list)
+{
+	zassert_true(CHECK(FLAGS, 0x11, BT_DATA_UUID128_ALL, TARGET), NULL);
+	zassert_true(CHECK(0x11, BT_DATA_UUID128_SOME, TARGET), NULL);
+}
+
+ZTEST(ad_filter, test_any_order)
+{
+	zassert_true(CHECK(NAME, 0x11, BT_DATA_UUID128_ALL, TARGET, FLAGS),
+		     "UUIDs before the flags");
+	zassert_true(CHECK(UUID16, NAME, 0x11, BT_DATA_UUID128_ALL, TARGET),
+		     "16-bit UUIDs and name first");
+	zassert_true(CHECK(0x21, BT_DATA_UUID128_ALL, OTHER, TARGET),
+		     "second UUID of the list");
+}
+
+ZTEST(ad_filter, test_lists)
+{
+	zassert_true(CHECK(0x11, BT_DATA_UUID128_SOME, OTHER,
+			   0x11, BT_DATA_UUID128_ALL, TARGET),
+		     "incomplete list does not rule the device out");
+	zassert_false(CHECK(0x11, BT_DATA_UUID128_ALL, OTHER,
+			    0x11, BT_DATA_UUID128_SOME, TARGET),
+		      "complete list without the target ends the search");
+	zassert_false(CHECK(FLAGS, NAME, UUID16), "no 128-bit UUIDs");
+	zassert_false(CHECK(0x11, BT_DATA_SVC_DATA128, TARGET),
+		      "service data is not a UUID list");
+}
+
+ZTEST(ad_filter, test_malformed)
+{
+	static const uint8_t full[] = { FLAGS, 0x11, BT_DATA_UUID128_ALL, TARGET };
+
+	zassert_false(check(full, 0), "empty report");
+	zassert_false(check(full, 1), "single byte");
+
+	/* Every truncation cuts the UUID structure short */
+	for (size_t len = 2; len < sizeof(full); len++) {
+		zassert_false(check(full, len), "truncated to %zu bytes", len);
+	}
+	zassert_true(check(full, sizeof(full)), NULL);
+
+	zassert_false(CHECK(FLAGS, 0x00, 0x11, BT_DATA_UUID128_ALL, TARGET),
+		      "data after a zero length is not significant");
+	zassert_false(CHECK(0xFF, BT_DATA_UUID128_ALL, TARGET),
+		      "length past the end of the report");
+	zassert_false(CHECK(0x10, BT_DATA_UUID128_ALL, TARGET),
+		      "partial UUID");
+}
+
+/* Simulated time stands still on native_posix while code runs, so time
+ * the benchmark with the host's clock there.
+ */
+static uint64_t bench_now_ns(void)
+{
+#if defined(CONFIG_BOARD_NATIVE_POSIX)
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return (uint64_t)ts.tv_sec * NSEC_PER_SEC + ts.tv_nsec;
+#else
+	return k_ticks_to_ns_floor64(k_uptime_ticks());
+#endif
+}
+
+#define BENCH_REPORTS 4096
+#define BENCH_ROUNDS 16
+
+static uint8_t reports[BENCH_REPORTS][31];
+static uint8_t report_len[BENCH_REPORTS];
+
+/* A crowded channel: mostly other devices, a few of ours, some junk */
+static void reports_fill(void)
+{
+	static const uint8_t ours[] = { FLAGS, 0x11, BT_DATA_UUID128_ALL, TARGET };
+	static const uint8_t theirs[] = { FLAGS, 0x11, BT_DATA_UUID128_ALL, OTHER };
+	static const uint8_t beacon[] = { FLAGS, 0x1a, BT_DATA_MANUFACTURER_DATA,
+		0x4c, 0x00, 0x02, 0x15, OTHER, 0x00, 0x01, 0x00, 0x02, 0xc5 };
+	static const uint8_t named[] = { FLAGS, UUID16, NAME, 0x0a,
+		BT_DATA_MANUFACTURER_DATA, 1, 2, 3, 4, 5, 6, 7, 8, 9 };
+	uint32_t seed = 1;
+
+	for (size_t i = 0; i < BENCH_REPORTS; i++) {
+		const uint8_t *src;
+		size_t len;
+
+		seed = seed * 1103515245U + 12345U;
+
+		switch ((seed >> 16) % 8) {
+		case 0:
+			src = ours;
+			len = sizeof(ours);
+			break;
+		case 1:
+		case 2:
+			src = theirs;
+			len = sizeof(theirs);
+			break;
+		case 3:
+		case 4:
+		case 5:
+			src = beacon;
+			len = sizeof(beacon);
+			break;
+		case 6:
+			src = named;
+			len = sizeof(named);
+			break;
+		default:
+			/* Cut somewhere inside */
+			src = ours;
+			len = (seed >> 8) % sizeof(ours);
+			break;
+		}
+
+		memcpy(reports[i], src, len);
+		report_len[i] = len;
+	}
+}
+
+ZTEST(ad_filter, test_bench)
+{
+	uint32_t matches = 0;
+	uint64_t start, ns;
+
+	reports_fill();
+
+	start = bench_now_ns();
+	for (int round = 0; round < BENCH_ROUNDS; round++) {
+		for (size_t i = 0; i < BENCH_REPORTS; i++) {
+			matches += check(reports[i], report_len[i]);
+		}
+	}
+	ns = MAX(bench_now_ns() - start, 1);
+
+	zassert_true(matches > 0 && matches < BENCH_REPORTS * BENCH_ROUNDS,
+		     "%u matches", matches);
+
+	printk("[AD] %u reports, %llu ns/report, %llu reports/s\n",
+	       BENCH_REPORTS * BENCH_ROUNDS,
+	       (unsigned long long)(ns / (BENCH_REPORTS * BENCH_ROUNDS)),
+	       (unsigned long long)((uint64_t)BENCH_REPORTS * BENCH_ROUNDS *
+				    NSEC_PER_SEC / ns));
+}
+
+ZTEST_SUITE(ad_filter, NULL, NULL, NULL, NULL, NULL);
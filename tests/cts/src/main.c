@@ -0,0 +1,131 @@
+/*
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <zephyr/types.h>
+#include <stddef.h>
+#include <string.h>
+#include <errno.h>
+#include <zephyr/zephyr.h>
+#include <zephyr/ztest.h>
+
+#include "ct_codec.h"
+
+/* 2015-05-30 12:45:30 UTC, a Saturday */
+#define SAMPLE_EPOCH_MS (1432989930LL * MSEC_PER_SEC)
+
+#define CT(year, mon, day, h, m, s, dow, frac, reason) \
+	{ (year) & 0xff, (year) >> 8, mon, day, h, m, s, dow, frac, reason }
+
+ZTEST(cts, test_encode)
+{
+	static const uint8_t want[] = CT(2015, 5, 30, 12, 45, 30, 6, 0, 0);
+	uint8_t buf[CT_LEN];
+
+	ct_encode(SAMPLE_EPOCH_MS, 0, buf);
+	zassert_mem_equal(buf, want, sizeof(want), NULL);
+
+	/* Sunday is 7, not 0 */
+	ct_encode(1609718399LL * MSEC_PER_SEC, CT_ADJUST_EXTERNAL, buf);
+	zassert_equal(buf[7], 7, "day of week %u", buf[7]);
+	zassert_equal(buf[9], CT_ADJUST_EXTERNAL, NULL);
+}
+
+ZTEST(cts, test_fractions256)
+{
+	static const struct {
+		uint16_t ms;
+		uint8_t frac;
+	} cases[] = {
+		{ 0, 0 }, { 3, 0 }, { 4, 1 }, { 250, 64 }, { 500, 128 },
+		{ 996, 254 }, { 999, 255 },
+	};
+	uint8_t buf[CT_LEN];
+	int64_t epoch_ms;
+
+	for (size_t i = 0; i < ARRAY_SIZE(cases); i++) {
+		ct_encode(SAMPLE_EPOCH_MS + cases[i].ms, 0, buf);
+		zassert_equal(buf[8], cases[i].frac, "%u ms gave %u/256",
+			      cases[i].ms, buf[8]);
+		zassert_equal(buf[6], 30, "fraction spilled into seconds");
+
+		/* Back to the start of the fraction, never past the input;
+		 * both directions round down, hence the extra millisecond.
+		 */
+		zassert_ok(ct_decode(buf, &epoch_ms), NULL);
+		zassert_true(epoch_ms <= SAMPLE_EPOCH_MS + cases[i].ms &&
+			     SAMPLE_EPOCH_MS + cases[i].ms - epoch_ms <=
+			     MSEC_PER_SEC / 256 + 1, "%u ms decoded as %lld",
+			     cases[i].ms, epoch_ms - SAMPLE_EPOCH_MS);
+	}
+}
+
+ZTEST(cts, test_decode)
+{
+	static const uint8_t sample[] = CT(2015, 5, 30, 12, 45, 30, 6, 128, 1);
+	static const uint8_t leap[] = CT(2024, 2, 29, 0, 0, 0, 4, 0, 0);
+	/* Unknown day of week is allowed */
+	static const uint8_t no_dow[] = CT(2024, 2, 29, 0, 0, 0, 0, 0, 0);
+	int64_t epoch_ms;
+
+	zassert_ok(ct_decode(sample, &epoch_ms), NULL);
+	zassert_equal(epoch_ms, SAMPLE_EPOCH_MS + 500, NULL);
+
+	zassert_ok(ct_decode(leap, &epoch_ms), NULL);
+	zassert_equal(epoch_ms, 1709164800LL * MSEC_PER_SEC, NULL);
+	zassert_ok(ct_decode(no_dow, &epoch_ms), NULL);
+}
+
+ZTEST(cts, test_invalid)
+{
+	static const uint8_t invalid[][CT_LEN] = {
+		CT(0, 5, 30, 12, 45, 30, 6, 0, 0),	/* unknown year */
+		CT(1969, 12, 31, 23, 59, 59, 3, 0, 0),	/* before the epoch */
+		CT(10000, 1, 1, 0, 0, 0, 1, 0, 0),
+		CT(2015, 0, 30, 12, 45, 30, 6, 0, 0),	/* unknown month */
+		CT(2015, 13, 30, 12, 45, 30, 6, 0, 0),
+		CT(2015, 5, 0, 12, 45, 30, 6, 0, 0),	/* unknown day */
+		CT(2015, 4, 31, 12, 45, 30, 6, 0, 0),
+		CT(2023, 2, 29, 12, 0, 0, 3, 0, 0),	/* not a leap year */
+		CT(2100, 2, 29, 12, 0, 0, 1, 0, 0),
+		CT(2015, 5, 30, 24, 0, 0, 6, 0, 0),
+		CT(2015, 5, 30, 12, 60, 0, 6, 0, 0),
+		CT(2015, 5, 30, 12, 45, 60, 6, 0, 0),
+		CT(2015, 5, 30, 12, 45, 30, 8, 0, 0),
+	};
+	int64_t epoch_ms = 42;
+
+	for (size_t i = 0; i < ARRAY_SIZE(invalid); i++) {
+		zassert_equal(ct_decode(invalid[i], &epoch_ms), -EINVAL,
+			      "case %zu accepted", i);
+		zassert_equal(epoch_ms, 42, "case %zu wrote the time", i);
+	}
+}
+
+ZTEST(cts, test_anchor_past_32_bits)
+{
+	/* Anchored after 2^32 ms (about 50 days) of uptime */
+	const int64_t uptime_ms = BIT64(32) + 1234;
+	struct ct_anchor anchor = {
+		.epoch_ms = SAMPLE_EPOCH_MS,
+		.uptime_ms = uptime_ms,
+	};
+	uint8_t buf[CT_LEN];
+	int64_t epoch_ms;
+
+	zassert_equal(ct_anchor_now_ms(&anchor, uptime_ms), SAMPLE_EPOCH_MS,
+		      NULL);
+	zassert_equal(ct_anchor_now_ms(&anchor, uptime_ms + 1500),
+		      SAMPLE_EPOCH_MS + 1500, NULL);
+
+	/* Anchored just before the wrap of a 32-bit ms counter, read after */
+	anchor.uptime_ms = BIT64(32) - 1000;
+	zassert_equal(ct_anchor_now_ms(&anchor, BIT64(32) + 1000),
+		      SAMPLE_EPOCH_MS + 2000, NULL);
+
+	ct_encode(ct_anchor_now_ms(&anchor, BIT64(32) + 1000), 0, buf);
+	zassert_ok(ct_decode(buf, &epoch_ms), NULL);
+	zassert_equal(epoch_ms, SAMPLE_EPOCH_MS + 2000, NULL);
+}
+
+ZTEST_SUITE(cts, NULL, NULL, NULL, NULL, NULL);
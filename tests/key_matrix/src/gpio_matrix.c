@@ -0,0 +1,270 @@
+/** @file
+ *  @brief Emulated key matrix GPIO controller
+ *
+ *  Columns are outputs, rows inputs. A row reads high while current can
+ *  flow to it from a driven column through pressed keys, so three keys
+ *  on the corners of a rectangle light up the fourth, as on a matrix
+ *  without diodes. Only edge interrupts are supported.
+ */
+
+/*
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#define DT_DRV_COMPAT vnd_gpio_matrix
+
+#include <zephyr/types.h>
+#include <errno.h>
+#include <zephyr/zephyr.h>
+#include <zephyr/device.h>
+#include <zephyr/drivers/gpio.h>
+#include <zephyr/sys/slist.h>
+#include <zephyr/sys/util.h>
+
+#include "gpio_matrix.h"
+
+struct gpio_matrix_config {
+	/* Must be first */
+	struct gpio_driver_config common;
+	uint8_t rows;
+	uint8_t cols;
+};
+
+struct gpio_matrix_data {
+	/* Must be first */
+	struct gpio_driver_data common;
+	struct k_spinlock lock;
+	/* Rows reached through each column's pressed keys */
+	uint32_t keys[32 - GPIO_MATRIX_COL_PIN0];
+	uint32_t out;
+	uint32_t rows;
+	uint32_t int_rising;
+	uint32_t int_falling;
+	sys_slist_t callbacks;
+};
+
+static uint32_t rows_read(const struct gpio_matrix_config *cfg,
+			  const struct gpio_matrix_data *data)
+{
+	uint32_t cols = (data->out >> GPIO_MATRIX_COL_PIN0) & BIT_MASK(cfg->cols);
+	uint32_t rows = 0;
+	uint32_t prev;
+
+	/* Spread from the driven columns until no key adds a row or column */
+	do {
+		prev = cols;
+
+		for (size_t c = 0; c < cfg->cols; c++) {
+			if (cols & BIT(c)) {
+				rows |= data->keys[c];
+			}
+		}
+
+		for (size_t c = 0; c < cfg->cols; c++) {
+			if (data->keys[c] & rows) {
+				cols |= BIT(c);
+			}
+		}
+	} while (cols != prev);
+
+	return rows;
+}
+
+/* Re-evaluates the rows after any change and fires the edges */
+static void matrix_update(const struct device *dev, k_spinlock_key_t key)
+{
+	const struct gpio_matrix_config *cfg = dev->config;
+	struct gpio_matrix_data *data = dev->data;
+	struct gpio_callback *cb, *tmp;
+	uint32_t rows = rows_read(cfg, data);
+	uint32_t edges = (rows & ~data->rows & data->int_rising) |
+			 (~rows & data->rows & data->int_falling);
+
+	data->rows = rows;
+	k_spin_unlock(&data->lock, key);
+
+	if (!edges) {
+		return;
+	}
+
+	SYS_SLIST_FOR_EACH_CONTAINER_SAFE(&data->callbacks, cb, tmp, node) {
+		if (cb->pin_mask & edges) {
+			cb->handler(dev, cb, cb->pin_mask & edges);
+		}
+	}
+}
+
+void gpio_matrix_key_set(const struct device *dev, size_t col, size_t row,
+			 bool down)
+{
+	struct gpio_matrix_data *data = dev->data;
+	k_spinlock_key_t key = k_spin_lock(&data->lock);
+
+	WRITE_BIT(data->keys[col], row, down);
+	matrix_update(dev, key);
+}
+
+static int gpio_matrix_pin_configure(const struct device *dev, gpio_pin_t pin,
+				     gpio_flags_t flags)
+{
+	const struct gpio_matrix_config *cfg = dev->config;
+	struct gpio_matrix_data *data = dev->data;
+	k_spinlock_key_t key;
+
+	if (pin < GPIO_MATRIX_COL_PIN0) {
+		return (pin < cfg->rows && !(flags & GPIO_OUTPUT)) ? 0 : -ENOTSUP;
+	}
+
+	if (pin >= GPIO_MATRIX_COL_PIN0 + cfg->cols || (flags & GPIO_INPUT)) {
+		return -ENOTSUP;
+	}
+
+	key = k_spin_lock(&data->lock);
+	if (flags & GPIO_OUTPUT_INIT_HIGH) {
+		data->out |= BIT(pin);
+	} else if (flags & GPIO_OUTPUT_INIT_LOW) {
+		data->out &= ~BIT(pin);
+	}
+	matrix_update(dev, key);
+
+	return 0;
+}
+
+static int gpio_matrix_port_get_raw(const struct device *dev,
+				    gpio_port_value_t *value)
+{
+	struct gpio_matrix_data *data = dev->data;
+	k_spinlock_key_t key = k_spin_lock(&data->lock);
+
+	*value = data->rows | data->out;
+	k_spin_unlock(&data->lock, key);
+
+	return 0;
+}
+
+static int gpio_matrix_port_set_masked_raw(const struct device *dev,
+					   gpio_port_pins_t mask,
+					   gpio_port_value_t value)
+{
+	struct gpio_matrix_data *data = dev->data;
+	k_spinlock_key_t key = k_spin_lock(&data->lock);
+
+	data->out = (data->out & ~mask) | (value & mask);
+	matrix_update(dev, key);
+
+	return 0;
+}
+
+static int gpio_matrix_port_set_bits_raw(const struct device *dev,
+					 gpio_port_pins_t pins)
+{
+	return gpio_matrix_port_set_masked_raw(dev, pins, pins);
+}
+
+static int gpio_matrix_port_clear_bits_raw(const struct device *dev,
+					   gpio_port_pins_t pins)
+{
+	return gpio_matrix_port_set_masked_raw(dev, pins, 0);
+}
+
+static int gpio_matrix_port_toggle_bits(const struct device *dev,
+					gpio_port_pins_t pins)
+{
+	struct gpio_matrix_data *data = dev->data;
+	k_spinlock_key_t key = k_spin_lock(&data->lock);
+
+	data->out ^= pins;
+	matrix_update(dev, key);
+
+	return 0;
+}
+
+static int gpio_matrix_pin_interrupt_configure(const struct device *dev,
+					       gpio_pin_t pin,
+					       enum gpio_int_mode mode,
+					       enum gpio_int_trig trig)
+{
+	struct gpio_matrix_data *data = dev->data;
+	k_spinlock_key_t key;
+
+	if (mode == GPIO_INT_MODE_LEVEL) {
+		return -ENOTSUP;
+	}
+
+	key = k_spin_lock(&data->lock);
+	data->int_rising &= ~BIT(pin);
+	data->int_falling &= ~BIT(pin);
+
+	if (mode == GPIO_INT_MODE_EDGE) {
+		if (trig & GPIO_INT_TRIG_HIGH) {
+			data->int_rising |= BIT(pin);
+		}
+		if (trig & GPIO_INT_TRIG_LOW) {
+			data->int_falling |= BIT(pin);
+		}
+	}
+	k_spin_unlock(&data->lock, key);
+
+	return 0;
+}
+
+static int gpio_matrix_manage_callback(const struct device *dev,
+				       struct gpio_callback *callback, bool set)
+{
+	struct gpio_matrix_data *data = dev->data;
+	bool found = sys_slist_find_and_remove(&data->callbacks,
+					       &callback->node);
+
+	if (set) {
+		sys_slist_prepend(&data->callbacks, &callback->node);
+	} else if (!found) {
+		return -EINVAL;
+	}
+
+	return 0;
+}
+
+static const struct gpio_driver_api gpio_matrix_api = {
+	.pin_configure = gpio_matrix_pin_configure,
+	.port_get_raw = gpio_matrix_port_get_raw,
+	.port_set_masked_raw = gpio_matrix_port_set_masked_raw,
+	.port_set_bits_raw = gpio_matrix_port_set_bits_raw,
+	.port_clear_bits_raw = gpio_matrix_port_clear_bits_raw,
+	.port_toggle_bits = gpio_matrix_port_toggle_bits,
+	.pin_interrupt_configure = gpio_matrix_pin_interrupt_configure,
+	.manage_callback = gpio_matrix_manage_callback,
+};
+
+static int gpio_matrix_init(const struct device *dev)
+{
+	struct gpio_matrix_data *data = dev->data;
+
+	sys_slist_init(&data->callbacks);
+
+	return 0;
+}
+
+#define GPIO_MATRIX_DEFINE(inst)						\
+	BUILD_ASSERT(DT_INST_PROP(inst, rows) <= GPIO_MATRIX_COL_PIN0);	\
+	BUILD_ASSERT(DT_INST_PROP(inst, columns) <=				\
+		     32 - GPIO_MATRIX_COL_PIN0);				\
+										\
+	static const struct gpio_matrix_config gpio_matrix_config_##inst = {	\
+		.common = {							\
+			.port_pin_mask =					\
+				BIT_MASK(DT_INST_PROP(inst, rows)) |		\
+				(BIT_MASK(DT_INST_PROP(inst, columns)) <<	\
+				 GPIO_MATRIX_COL_PIN0),				\
+		},								\
+		.rows = DT_INST_PROP(inst, rows),				\
+		.cols = DT_INST_PROP(inst, columns),				\
+	};									\
+										\
+	static struct gpio_matrix_data gpio_matrix_data_##inst;			\
+										\
+	DEVICE_DT_INST_DEFINE(inst, gpio_matrix_init, NULL,			\
+			      &gpio_matrix_data_##inst,				\
+			      &gpio_matrix_config_##inst, POST_KERNEL,		\
+			      CONFIG_GPIO_INIT_PRIORITY, &gpio_matrix_api);
+
+DT_INST_FOREACH_STATUS_OKAY(GPIO_MATRIX_DEFINE)
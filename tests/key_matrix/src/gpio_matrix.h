@@ -0,0 +1,26 @@
+/** @file
+ *  @brief Emulated key matrix GPIO controller
+ */
+
+/*
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <zephyr/types.h>
+#include <zephyr/device.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define GPIO_MATRIX_COL_PIN0 16
+
+/* Presses or releases the key joining col and row. Row edges fire the
+ * interrupt callbacks as a real matrix would.
+ */
+void gpio_matrix_key_set(const struct device *dev, size_t col, size_t row,
+			 bool down);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,143 @@
+/*
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <zephyr/types.h>
+#include <stddef.h>
+#include <string.h>
+#include <zephyr/zephyr.h>
+#include <zephyr/device.h>
+#include <zephyr/ztest.h>
+
+#include "gpio_matrix.h"
+#include "key_matrix.h"
+
+#define ROWS 3
+#define COLS 3
+#define KEY(col, row) ((col) * ROWS + (row))
+
+/* Two passes have to agree, give the scanner a few */
+#define SETTLE K_MSEC(50)
+
+static const struct device *const matrix =
+	DEVICE_DT_GET(DT_NODELABEL(matrix_gpio));
+
+static struct {
+	uint8_t key;
+	bool down;
+} events[16];
+static size_t event_count;
+
+static void matrix_cb(uint8_t key, bool down, int64_t timestamp)
+{
+	if (event_count < ARRAY_SIZE(events)) {
+		events[event_count].key = key;
+		events[event_count].down = down;
+	}
+	event_count++;
+}
+
+static void key_set(size_t col, size_t row, bool down)
+{
+	gpio_matrix_key_set(matrix, col, row, down);
+	k_sleep(SETTLE);
+}
+
+static bool event_seen(uint8_t key, bool down)
+{
+	for (size_t i = 0; i < MIN(event_count, ARRAY_SIZE(events)); i++) {
+		if (events[i].key == key && events[i].down == down) {
+			return true;
+		}
+	}
+
+	return false;
+}
+
+ZTEST(key_matrix, test_single_key)
+{
+	key_set(1, 2, true);
+	zassert_equal(event_count, 1, "%zu events", event_count);
+	zassert_true(event_seen(KEY(1, 2), true), NULL);
+
+	key_set(1, 2, false);
+	zassert_equal(event_count, 2, "%zu events", event_count);
+	zassert_true(event_seen(KEY(1, 2), false), NULL);
+}
+
+ZTEST(key_matrix, test_rollover)
+{
+	/* One key per row and column never forms a rectangle */
+	key_set(0, 0, true);
+	key_set(1, 1, true);
+	key_set(2, 2, true);
+	zassert_equal(event_count, 3, "%zu events", event_count);
+
+	/* Nor does a full column */
+	key_set(0, 1, true);
+	key_set(0, 2, true);
+	zassert_equal(event_count, 5, "%zu events", event_count);
+
+	for (size_t i = 0; i < event_count; i++) {
+		zassert_true(events[i].down, "event %zu is a release", i);
+	}
+	zassert_true(event_seen(KEY(0, 1), true), NULL);
+	zassert_true(event_seen(KEY(0, 2), true), NULL);
+}
+
+ZTEST(key_matrix, test_ghost)
+{
+	key_set(0, 0, true);
+	key_set(0, 1, true);
+	zassert_equal(event_count, 2, "%zu events", event_count);
+
+	/* Third corner: (1, 1) reads as pressed too, nothing is reported */
+	key_set(1, 0, true);
+	zassert_equal(event_count, 2, "ghost pass reported");
+	zassert_false(event_seen(KEY(1, 1), true), "ghost key reported");
+
+	/* The rectangle breaks: the real change since the last good pass */
+	key_set(0, 1, false);
+	zassert_equal(event_count, 4, "%zu events", event_count);
+	zassert_true(event_seen(KEY(1, 0), true), NULL);
+	zassert_true(event_seen(KEY(0, 1), false), NULL);
+	zassert_false(event_seen(KEY(1, 1), true), "ghost key reported");
+}
+
+ZTEST(key_matrix, test_rearm)
+{
+	/* After every release the scanner goes back to row interrupts */
+	for (int i = 0; i < 3; i++) {
+		key_set(2, 0, true);
+		key_set(2, 0, false);
+	}
+
+	zassert_equal(event_count, 6, "%zu events", event_count);
+	for (size_t i = 0; i < event_count; i++) {
+		zassert_equal(events[i].key, KEY(2, 0), NULL);
+		zassert_equal(events[i].down, !(i % 2), "event %zu", i);
+	}
+}
+
+static void *key_matrix_setup(void)
+{
+	zassert_true(device_is_ready(matrix), NULL);
+	zassert_ok(key_matrix_init(matrix_cb), NULL);
+
+	return NULL;
+}
+
+static void key_matrix_after(void *fixture)
+{
+	for (size_t c = 0; c < COLS; c++) {
+		for (size_t r = 0; r < ROWS; r++) {
+			gpio_matrix_key_set(matrix, c, r, false);
+		}
+	}
+
+	/* Let the scanner report the releases and go idle */
+	k_sleep(SETTLE);
+	event_count = 0;
+}
+
+ZTEST_SUITE(key_matrix, NULL, key_matrix_setup, NULL, key_matrix_after, NULL);
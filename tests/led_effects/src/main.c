@@ -0,0 +1,126 @@
+/*
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <zephyr/types.h>
+#include <stddef.h>
+#include <string.h>
+#include <time.h>
+#include <zephyr/zephyr.h>
+#include <zephyr/ztest.h>
+#include <zephyr/sys/printk.h>
+
+#include "led_engine.h"
+
+#define PIXELS_MAX 1000
+
+static struct led_rgb frame[PIXELS_MAX];
+
+#define RGB(red, green, blue) \
+	((struct led_rgb) { .r = (red), .g = (green), .b = (blue) })
+
+static void assert_px(size_t i, struct led_rgb want)
+{
+	zassert_true(frame[i].r == want.r && frame[i].g == want.g &&
+		     frame[i].b == want.b,
+		     "pixel %zu is %u/%u/%u, want %u/%u/%u", i, frame[i].r,
+		     frame[i].g, frame[i].b, want.r, want.g, want.b);
+}
+
+ZTEST(led_effects, test_rainbow)
+{
+	led_effect_render(LED_EFFECT_RAINBOW, frame, 100, 0);
+
+	/* Hue 0 first, and every pixel fully saturated at half brightness */
+	assert_px(0, RGB(128, 0, 0));
+	for (size_t i = 0; i < 100; i++) {
+		uint8_t hi = MAX(frame[i].r, MAX(frame[i].g, frame[i].b));
+		uint8_t lo = MIN(frame[i].r, MIN(frame[i].g, frame[i].b));
+
+		zassert_equal(hi, 128, "pixel %zu peaks at %u", i, hi);
+		zassert_equal(lo, 0, "pixel %zu floor at %u", i, lo);
+	}
+
+	/* Hue 86, a third of a turn, starts the pure green sector */
+	assert_px(34, RGB(0, 128, 0));
+}
+
+ZTEST(led_effects, test_breathe)
+{
+	/* Peak of the sine, then its trough */
+	led_effect_render(LED_EFFECT_BREATHE, frame, 10, 512);
+	for (size_t i = 0; i < 10; i++) {
+		assert_px(i, RGB(255, 96, 16));
+	}
+
+	led_effect_render(LED_EFFECT_BREATHE, frame, 10, 1536);
+	for (size_t i = 0; i < 10; i++) {
+		assert_px(i, RGB(1, 0, 0));
+	}
+}
+
+ZTEST(led_effects, test_comet)
+{
+	/* 60 pixels per second: the head is on pixel 60 after one second */
+	led_effect_render(LED_EFFECT_COMET, frame, 100, MSEC_PER_SEC);
+
+	zassert_equal(MAX(frame[60].r, MAX(frame[60].g, frame[60].b)), 255,
+		      "head not at full brightness");
+	assert_px(61, RGB(0, 0, 0));
+	zassert_equal(MAX(frame[59].r, MAX(frame[59].g, frame[59].b)), 239,
+		      "tail does not fade");
+	assert_px(44, RGB(0, 0, 0));
+
+	/* The tail wraps around the end of the strip */
+	led_effect_render(LED_EFFECT_COMET, frame, 100, 0);
+	zassert_equal(MAX(frame[99].r, MAX(frame[99].g, frame[99].b)), 239,
+		      "tail does not wrap");
+}
+
+ZTEST(led_effects, test_empty)
+{
+	memset(frame, 0xAA, sizeof(frame));
+	led_effect_render(LED_EFFECT_RAINBOW, frame, 0, 0);
+	zassert_equal(frame[0].r, 0xAA, "empty strip written");
+}
+
+/* Simulated time stands still on native_posix while code runs, so time
+ * the benchmark with the host's clock there.
+ */
+static uint64_t bench_now_ns(void)
+{
+#if defined(CONFIG_BOARD_NATIVE_POSIX)
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return (uint64_t)ts.tv_sec * NSEC_PER_SEC + ts.tv_nsec;
+#else
+	return k_ticks_to_ns_floor64(k_uptime_ticks());
+#endif
+}
+
+#define BENCH_FRAMES 64
+
+ZTEST(led_effects, test_bench)
+{
+	static const size_t lengths[] = { 100, 500, 1000 };
+
+	for (int e = 0; e < LED_EFFECT_COUNT; e++) {
+		for (size_t l = 0; l < ARRAY_SIZE(lengths); l++) {
+			uint64_t start = bench_now_ns();
+			uint64_t ns;
+
+			for (uint32_t t = 0; t < BENCH_FRAMES; t++) {
+				led_effect_render(e, frame, lengths[l], t * 20U);
+			}
+			ns = MAX(bench_now_ns() - start, 1);
+
+			printk("[LED] effect %d, %zu pixels: %llu ns/frame\n",
+			       e, lengths[l],
+			       (unsigned long long)(ns / BENCH_FRAMES));
+		}
+	}
+}
+
+ZTEST_SUITE(led_effects, NULL, NULL, NULL, NULL, NULL);